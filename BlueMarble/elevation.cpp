@@ -0,0 +1,136 @@
+#include "elevation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include <glm/ext.hpp>
+#include <stb_image.h>
+
+#include "parallel.h"
+
+namespace {
+
+GLuint createElevationTexture(GLint internal_format, GLsizei texture_width,
+					GLsizei texture_height, GLenum format, GLenum type,
+					const void* data) {
+	GLuint texture_id;
+	glGenTextures(1, &texture_id);
+	glBindTexture(GL_TEXTURE_2D, texture_id);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+	glTexImage2D(GL_TEXTURE_2D, 0, internal_format, texture_width,
+		texture_height, 0, format, type, data
+	);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return texture_id;
+}
+
+// Diferencas centrais em metros: a coluna da costura da a volta (u e
+// periodico) e as linhas dos polos repetem a borda.
+void computeSlopes(const std::uint16_t* heights, int map_width, int map_height,
+					const ElevationSettings& settings, std::vector<float>& slopes) {
+	const float meters_per_unit =
+		(settings.max_elevation - settings.min_elevation) / 65535.0f;
+	const float row_meters = glm::pi<float>() * settings.planet_radius / map_height;
+	const float column_meters = glm::two_pi<float>() * settings.planet_radius / map_width;
+
+	slopes.resize(static_cast<size_t>(map_width) * map_height * 2);
+
+	parallelFor(0, map_height, [&](size_t row_begin, size_t row_end) {
+		for (size_t y = row_begin; y < row_end; y++) {
+			const float theta = (y + 0.5f) / map_height * glm::pi<float>();
+			const float east_meters = column_meters * std::max(std::sin(theta), 1e-3f);
+
+			const std::uint16_t* row = heights + y * map_width;
+			const std::uint16_t* north = heights + (y > 0 ? y - 1 : y) * map_width;
+			const std::uint16_t* south = heights + std::min<size_t>(y + 1, map_height - 1) * map_width;
+			const float south_span = static_cast<float>(
+				std::min<size_t>(y + 1, map_height - 1) - (y > 0 ? y - 1 : y));
+
+			float* slope_row = slopes.data() + y * map_width * 2;
+
+			for (int x = 0; x < map_width; x++) {
+				const int west = (x + map_width - 1) % map_width;
+				const int east = (x + 1) % map_width;
+
+				const float dx = (static_cast<float>(row[east]) - row[west]) * meters_per_unit;
+				const float dy = (static_cast<float>(south[x]) - north[x]) * meters_per_unit;
+
+				slope_row[x * 2] = dx / (2.0f * east_meters);
+				slope_row[x * 2 + 1] = south_span > 0.0f ? dy / (south_span * row_meters) : 0.0f;
+			}
+		}
+	}, 16);
+}
+
+ElevationMaps flatElevation() {
+	const std::uint16_t height = 0;
+	const float slope[2] = { 0.0f, 0.0f };
+
+	ElevationMaps maps;
+	maps.height_texture = createElevationTexture(GL_R16, 1, 1, GL_RED,
+		GL_UNSIGNED_SHORT, &height);
+	maps.slope_texture = createElevationTexture(GL_RG16F, 1, 1, GL_RG,
+		GL_FLOAT, slope);
+	return maps;
+}
+
+}
+
+ElevationMaps loadElevation(const char* heightmap_file,
+					const ElevationSettings& settings) {
+	if (heightmap_file == nullptr || heightmap_file[0] == '\0') {
+		return flatElevation();
+	}
+
+	std::cout << "Carregando heightmap ... " << heightmap_file << std::endl;
+
+	int map_width = 0;
+	int map_height = 0;
+	int number_of_components = 0;
+
+	stbi_us* heights = stbi_load_16(heightmap_file, &map_width, &map_height,
+		&number_of_components, 1
+	);
+
+	if (!heights) {
+		std::cout << "Heightmap nao encontrado, globo sem relevo - "
+			<< heightmap_file << std::endl;
+		return flatElevation();
+	}
+
+	std::vector<float> slopes;
+	computeSlopes(heights, map_width, map_height, settings, slopes);
+
+	ElevationMaps maps;
+	maps.flat = false;
+	maps.height_range = glm::vec2{ settings.min_elevation, settings.max_elevation } /
+		settings.planet_radius;
+	maps.height_texture = createElevationTexture(GL_R16, map_width, map_height,
+		GL_RED, GL_UNSIGNED_SHORT, heights);
+	maps.slope_texture = createElevationTexture(GL_RG16F, map_width, map_height,
+		GL_RG, GL_FLOAT, slopes.data());
+
+	stbi_image_free(heights);
+
+	return maps;
+}
+
+void releaseElevation(ElevationMaps& maps) {
+	glDeleteTextures(1, &maps.height_texture);
+	glDeleteTextures(1, &maps.slope_texture);
+	maps = ElevationMaps{};
+}
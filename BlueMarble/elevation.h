@@ -0,0 +1,34 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// Relevo do globo a partir de um heightmap equiretangular de 16 bits.
+// triangle_vert.glsl desloca cada vertice pela altura (height_texture) e
+// triangle_frag.glsl inclina a normal pelas derivadas da altura
+// (slope_texture), calculadas uma vez no carregamento. O exagero do relevo e
+// so um uniform: muda-lo nao regenera malha nem textura.
+struct ElevationSettings {
+	// Altitudes, em metros, dos valores 0 e 65535 do heightmap.
+	float min_elevation = 0.0f;
+	float max_elevation = 8848.0f;
+	float planet_radius = 6371000.0f;
+};
+
+struct ElevationMaps {
+	// GL_R16, altura normalizada em [0, 1].
+	GLuint height_texture = 0;
+	// GL_RG16F, inclinacao (metros por metro) para leste e para o sul.
+	GLuint slope_texture = 0;
+	// Deslocamento, em raios da esfera, das alturas 0 e 1 sem exagero.
+	glm::vec2 height_range{ 0.0f, 0.0f };
+	// Sem heightmap: texturas 1x1 planas.
+	bool flat = true;
+};
+
+// Sem arquivo (vazio) ou se ele nao existir devolve mapas planos, entao o
+// resto do renderizador nao precisa tratar a falta de relevo.
+ElevationMaps loadElevation(const char* heightmap_file,
+					const ElevationSettings& settings = ElevationSettings{});
+
+void releaseElevation(ElevationMaps& maps);
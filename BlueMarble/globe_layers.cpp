@@ -0,0 +1,37 @@
+#include "globe_layers.h"
+
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+const char* const layer_names[globe_layer_count] = { "dia", "noite", "nuvens", "especular" };
+
+}
+
+GlobeLayers loadGlobeLayers(TextureManager& texture_manager, const GlobeLayerFiles& files) {
+	GlobeLayers layers;
+
+	std::error_code error;
+	if (!std::filesystem::exists(files[GlobeLayer::Day], error)) {
+		std::cout << "Erro ao ler camada do dia - " << files[GlobeLayer::Day] << std::endl;
+		return layers;
+	}
+
+	std::vector<std::string> present;
+	std::cout << "Camadas do globo -";
+	for (size_t index = 0; index < globe_layer_count; index++) {
+		const std::string& file = files.files[index];
+		if (file.empty() || !std::filesystem::exists(file, error)) {
+			continue;
+		}
+		present.push_back(file);
+		layers.loaded_mask |= 1u << index;
+		std::cout << " " << layer_names[index];
+	}
+	std::cout << std::endl;
+
+	layers.texture_array = texture_manager.loadArray(present);
+	return layers;
+}
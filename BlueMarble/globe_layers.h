@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <string>
+
+#include <GL/glew.h>
+
+#include "texture_manager.h"
+
+// Camadas de material do globo empilhadas em uma GL_TEXTURE_2D_ARRAY:
+// triangle_frag.glsl le todas por um unico sampler (layer_sampler), entao
+// custam um bind e nenhum uniform de sampler a mais por camada.
+//
+// A array vai pelo TextureManager (loadArray): thread de trabalho, containers
+// em cache/ e orcamento de VRAM. So entram as camadas cujo arquivo existe, em
+// sequencia depois do dia; as que faltam ficam fora da textura e tambem do
+// shader (NIGHT_LAYER, CLOUD_LAYER e SPECULAR_LAYER em shader_variants.h).
+enum class GlobeLayer {
+	Day,
+	// Luzes das cidades, somadas no lado escuro.
+	Night,
+	// Cobertura de nuvens no vermelho.
+	Clouds,
+	// Mascara do brilho especular (oceanos) no vermelho.
+	Specular
+};
+
+constexpr size_t globe_layer_count = 4;
+
+struct GlobeLayerFiles {
+	std::array<std::string, globe_layer_count> files{
+		"textures/earth_2k.jpg",
+		"textures/earth_night_2k.jpg",
+		"textures/earth_clouds_2k.jpg",
+		"textures/earth_specular_2k.png"
+	};
+
+	std::string& operator[](GlobeLayer layer) { return files[static_cast<size_t>(layer)]; }
+	const std::string& operator[](GlobeLayer layer) const { return files[static_cast<size_t>(layer)]; }
+};
+
+struct GlobeLayers {
+	// Do TextureManager, que tambem a apaga.
+	GLuint texture_array = 0;
+	// Bit (1 << camada) para cada camada presente na textura.
+	GLuint loaded_mask = 0;
+
+	bool has(GlobeLayer layer) const { return loaded_mask & (1u << static_cast<size_t>(layer)); }
+};
+
+// Sem o arquivo do dia devolve texture_array 0 e o chamador segue com a
+// textura 2D.
+GlobeLayers loadGlobeLayers(TextureManager& texture_manager, const GlobeLayerFiles& files);
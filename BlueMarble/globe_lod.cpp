@@ -0,0 +1,283 @@
+#include "globe_lod.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+
+#include <glm/ext.hpp>
+
+#include "sphere_mesh.h"
+
+namespace {
+
+constexpr GLuint grid_attribute = 0;
+constexpr GLuint patch_attribute = 4;
+constexpr GLuint morph_attribute = 5;
+
+// Fracao do alcance de cada nivel em que o morph comeca.
+constexpr float morph_start_ratio = 0.66f;
+
+}
+
+void GlobeLod::initialize(const Settings& lod_settings) {
+	settings = lod_settings;
+
+	const GLuint n = settings.grid_resolution;
+	assert(n >= 2 && (n & (n - 1)) == 0);
+	assert((n + 1) * (n + 1) <= 65536);
+
+	std::vector<glm::vec2> grid;
+	grid.reserve((n + 1) * (n + 1));
+	for (GLuint y = 0; y <= n; y++) {
+		for (GLuint x = 0; x <= n; x++) {
+			grid.emplace_back(static_cast<float>(x), static_cast<float>(y));
+		}
+	}
+
+	// Indices agrupados por quadrante para que um no possa ser desenhado so
+	// nas partes em que os filhos nao foram selecionados.
+	const GLuint half = n / 2;
+	std::vector<std::uint16_t> indices;
+	indices.reserve(n * n * 6);
+	for (int quadrant = 0; quadrant < 4; quadrant++) {
+		const GLuint x_begin = (quadrant & 1) * half;
+		const GLuint y_begin = (quadrant >> 1) * half;
+		for (GLuint y = y_begin; y < y_begin + half; y++) {
+			for (GLuint x = x_begin; x < x_begin + half; x++) {
+				const std::uint16_t p0 = static_cast<std::uint16_t>(y * (n + 1) + x);
+				const std::uint16_t p1 = static_cast<std::uint16_t>(p0 + 1);
+				const std::uint16_t p3 = static_cast<std::uint16_t>(p0 + n + 1);
+				const std::uint16_t p2 = static_cast<std::uint16_t>(p3 + 1);
+
+				indices.insert(indices.end(), { p0, p1, p3, p3, p1, p2 });
+			}
+		}
+	}
+	quadrant_index_count = static_cast<GLsizei>(half * half * 6);
+
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	glGenBuffers(1, &grid_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, grid_buffer);
+	glBufferData(GL_ARRAY_BUFFER, grid.size() * sizeof(glm::vec2),
+		grid.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(grid_attribute);
+	glVertexAttribPointer(grid_attribute, 2, GL_FLOAT, GL_FALSE,
+		sizeof(glm::vec2), nullptr);
+
+	glGenBuffers(1, &index_buffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(std::uint16_t),
+		indices.data(), GL_STATIC_DRAW);
+
+	glGenBuffers(1, &instance_buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+	glEnableVertexAttribArray(patch_attribute);
+	glEnableVertexAttribArray(morph_attribute);
+	glVertexAttribDivisor(patch_attribute, 1);
+	glVertexAttribDivisor(morph_attribute, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	detail_distance.resize(settings.max_depth + 1);
+}
+
+void GlobeLod::release() {
+	glDeleteBuffers(1, &instance_buffer);
+	glDeleteBuffers(1, &index_buffer);
+	glDeleteBuffers(1, &grid_buffer);
+	glDeleteVertexArrays(1, &vao);
+	vao = grid_buffer = index_buffer = instance_buffer = 0;
+}
+
+void GlobeLod::nodeBounds(const node& current, glm::vec3& center, float& radius) const {
+	center = cubeToSphere(current.face, current.offset + glm::vec2{ current.size * 0.5f });
+
+	// A calota do no fica dentro da esfera que passa pelos cantos.
+	radius = 0.0f;
+	for (int corner = 0; corner < 4; corner++) {
+		const glm::vec2 s = current.offset +
+			glm::vec2{ (corner & 1) * current.size, (corner >> 1) * current.size };
+		radius = std::max(radius, glm::distance(center, cubeToSphere(current.face, s)));
+	}
+
+	// O relevo so sobe a partir da esfera.
+	radius += max_displacement;
+}
+
+bool GlobeLod::isVisible(const glm::vec3& center, float radius) const {
+	for (const glm::vec4& plane : frustum_planes) {
+		if (glm::dot(glm::vec3{ plane }, center) + plane.w < -radius) {
+			return false;
+		}
+	}
+
+	// Horizonte: o no some atras da esfera quando todos os seus pontos estao
+	// a mais de acos(1 / distancia) da direcao da camera. Um pico de altura h
+	// ainda aparece ate acos(1 / (1 + h)) alem disso.
+	const float camera_distance = glm::length(camera);
+	if (camera_distance <= 1.0f) {
+		return true;
+	}
+
+	const float cap_angle = 2.0f * std::asin(std::min(1.0f, (radius - max_displacement) * 0.5f));
+	const float center_angle = std::acos(glm::clamp(
+		glm::dot(glm::normalize(center), camera / camera_distance), -1.0f, 1.0f));
+	return center_angle - cap_angle <=
+		std::acos(horizon_cos) + std::acos(1.0f / (1.0f + max_displacement));
+}
+
+void GlobeLod::addPatch(const node& current, int quadrant) {
+	// O no de profundidade d e usado entre detail_distance[d] * K e o dobro
+	// disso; o morph termina no fim desse alcance.
+	instance patch;
+	patch.patch = glm::vec4{ static_cast<float>(current.face),
+							 current.offset.x, current.offset.y, current.size };
+
+	if (current.depth == 0) {
+		const float never = std::numeric_limits<float>::max();
+		patch.morph = glm::vec2{ never * 0.5f, never };
+	} else {
+		const float range_end = detail_distance[current.depth - 1];
+		const float range_begin = detail_distance[current.depth];
+		patch.morph = glm::vec2{
+			glm::mix(range_begin, range_end, morph_start_ratio), range_end };
+	}
+
+	if (quadrant < 0) {
+		for (std::vector<instance>& instances : quadrant_instances) {
+			instances.push_back(patch);
+		}
+		frame_stats.triangles += settings.grid_resolution * settings.grid_resolution * 2;
+	} else {
+		quadrant_instances[quadrant].push_back(patch);
+		frame_stats.triangles += settings.grid_resolution * settings.grid_resolution / 2;
+	}
+
+	frame_stats.patches++;
+	frame_stats.deepest_level = std::max(frame_stats.deepest_level, current.depth);
+}
+
+bool GlobeLod::selectNode(const node& current) {
+	glm::vec3 center;
+	float radius;
+	nodeBounds(current, center, radius);
+
+	const float distance = std::max(0.0f, glm::distance(camera, center) - radius);
+
+	if (current.depth > 0 && distance > detail_distance[current.depth - 1]) {
+		return false;
+	}
+
+	if (!isVisible(center, radius)) {
+		return true;
+	}
+
+	if (current.depth == settings.max_depth ||
+		distance > detail_distance[current.depth]) {
+		addPatch(current, -1);
+		return true;
+	}
+
+	const float child_size = current.size * 0.5f;
+	for (int quadrant = 0; quadrant < 4; quadrant++) {
+		const node child{
+			current.face,
+			current.offset + glm::vec2{ (quadrant & 1) * child_size,
+										(quadrant >> 1) * child_size },
+			child_size,
+			current.depth + 1
+		};
+
+		if (!selectNode(child)) {
+			addPatch(current, quadrant);
+		}
+	}
+
+	return true;
+}
+
+void GlobeLod::select(const glm::vec3& camera_position,
+					const glm::mat4& model_view_projection,
+					float viewport_height, float fov) {
+	camera = camera_position;
+
+	// Distancia em que a aresta da grade de cada profundidade (arco entre
+	// vertices no centro da face) projeta target_edge_pixels na tela.
+	const float pixels_per_unit = viewport_height / (2.0f * std::tan(fov * 0.5f));
+	const GLuint n = settings.grid_resolution;
+	for (GLuint depth = 0; depth <= settings.max_depth; depth++) {
+		const float edge = glm::half_pi<float>() / static_cast<float>(n) /
+			static_cast<float>(1u << depth);
+		detail_distance[depth] = edge * pixels_per_unit / settings.target_edge_pixels;
+	}
+
+	// Planos do frustum em coordenadas do objeto (Gribb e Hartmann).
+	const glm::mat4 m = glm::transpose(model_view_projection);
+	frustum_planes = {
+		m[3] + m[0], m[3] - m[0],
+		m[3] + m[1], m[3] - m[1],
+		m[3] + m[2], m[3] - m[2]
+	};
+	for (glm::vec4& plane : frustum_planes) {
+		plane /= glm::length(glm::vec3{ plane });
+	}
+
+	const float camera_distance = glm::length(camera);
+	horizon_cos = camera_distance > 1.0f ? 1.0f / camera_distance : 0.0f;
+
+	frame_stats = Stats{};
+	for (std::vector<instance>& instances : quadrant_instances) {
+		instances.clear();
+	}
+
+	for (size_t face = 0; face < cube_face_count; face++) {
+		selectNode(node{ face, glm::vec2{ -1.0f }, 2.0f, 0 });
+	}
+}
+
+void GlobeLod::draw() const {
+	size_t total = 0;
+	for (const std::vector<instance>& instances : quadrant_instances) {
+		total += instances.size();
+	}
+	if (total == 0) {
+		return;
+	}
+
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+
+	// Buffer orfao a cada frame para nao esperar o desenho anterior.
+	glBufferData(GL_ARRAY_BUFFER, total * sizeof(instance), nullptr, GL_STREAM_DRAW);
+
+	size_t first = 0;
+	for (const std::vector<instance>& instances : quadrant_instances) {
+		glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(instance),
+			instances.size() * sizeof(instance), instances.data());
+		first += instances.size();
+	}
+
+	first = 0;
+	for (int quadrant = 0; quadrant < 4; quadrant++) {
+		const std::vector<instance>& instances = quadrant_instances[quadrant];
+		if (!instances.empty()) {
+			const size_t offset = first * sizeof(instance);
+			glVertexAttribPointer(patch_attribute, 4, GL_FLOAT, GL_FALSE, sizeof(instance),
+				reinterpret_cast<void*>(offset + offsetof(instance, patch)));
+			glVertexAttribPointer(morph_attribute, 2, GL_FLOAT, GL_FALSE, sizeof(instance),
+				reinterpret_cast<void*>(offset + offsetof(instance, morph)));
+
+			glDrawElementsInstanced(GL_TRIANGLES, quadrant_index_count, GL_UNSIGNED_SHORT,
+				reinterpret_cast<void*>(quadrant * quadrant_index_count * sizeof(std::uint16_t)),
+				static_cast<GLsizei>(instances.size()));
+		}
+		first += instances.size();
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// LOD continuo por blocos (CDLOD, Strugar 2010) sobre as seis faces da cube
+// sphere. Cada face e a raiz de uma quadtree; os nos escolhidos sao
+// desenhados como instancias de uma unica grade de grid_resolution x
+// grid_resolution quads, e triangle_vert.glsl projeta a grade na esfera e
+// faz o morph dos vertices impares para o nivel mais grosso perto do fim do
+// alcance de cada nivel, o que fecha as bordas entre niveis diferentes.
+class GlobeLod {
+public:
+	struct Settings {
+		// Potencia de 2; a grade tem (grid_resolution + 1)^2 vertices.
+		GLuint grid_resolution = 32;
+		GLuint max_depth = 16;
+		// Comprimento alvo de uma aresta de triangulo na tela, em pixels.
+		float target_edge_pixels = 8.0f;
+	};
+
+	struct Stats {
+		size_t patches = 0;
+		size_t triangles = 0;
+		GLuint deepest_level = 0;
+	};
+
+	void initialize(const Settings& settings);
+	void release();
+
+	// camera_position em coordenadas do objeto; model_view_projection e
+	// usada para o frustum culling.
+	void select(const glm::vec3& camera_position,
+				const glm::mat4& model_view_projection,
+				float viewport_height, float fov);
+
+	void draw() const;
+
+	// Maior elevacao dos vertices acima da esfera unitaria (relevo com
+	// exagero); alarga os volumes de culling e o horizonte.
+	void setMaxDisplacement(float displacement) { max_displacement = displacement; }
+
+	const Stats& stats() const { return frame_stats; }
+	GLuint gridResolution() const { return settings.grid_resolution; }
+
+private:
+	struct instance {
+		// face, deslocamento x/y e tamanho do no em coordenadas da face [-1, 1].
+		glm::vec4 patch;
+		// Distancias de inicio e fim do morph do nivel do no.
+		glm::vec2 morph;
+	};
+
+	struct node {
+		size_t face;
+		glm::vec2 offset;
+		float size;
+		GLuint depth;
+	};
+
+	bool selectNode(const node& current);
+	void addPatch(const node& current, int quadrant);
+	bool isVisible(const glm::vec3& center, float radius) const;
+	void nodeBounds(const node& current, glm::vec3& center, float& radius) const;
+
+	Settings settings;
+
+	GLuint vao = 0;
+	GLuint grid_buffer = 0;
+	GLuint index_buffer = 0;
+	GLuint instance_buffer = 0;
+	GLsizei quadrant_index_count = 0;
+
+	// Distancia minima em que cada profundidade ainda respeita o alvo em pixels.
+	std::vector<float> detail_distance;
+
+	glm::vec3 camera;
+	std::array<glm::vec4, 6> frustum_planes;
+	float horizon_cos = 0.0f;
+	float max_displacement = 0.0f;
+
+	// Nos desenhados por inteiro aparecem nos quatro quadrantes.
+	std::array<std::vector<instance>, 4> quadrant_instances;
+	Stats frame_stats;
+};
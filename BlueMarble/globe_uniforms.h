@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Espelho em C++ dos blocos std140 de shaders/globe_data.glsl; qualquer
+// mudanca de um lado precisa ser feita no outro. vec3 vira vec4 nos dois
+// para nao depender do alinhamento de vec3 no std140.
+
+constexpr unsigned frame_data_binding = 0;
+constexpr unsigned object_data_binding = 1;
+
+// Um por quadro, igual para todos os programas.
+struct FrameData {
+	glm::mat4 view;
+	glm::mat4 projection;
+	// xyz no espaco da camera.
+	glm::vec4 light_direction;
+	float light_intensity;
+	float specular_exponent;
+	float padding[2];
+};
+
+// Um por objeto desenhado (hoje so o globo).
+struct ObjectData {
+	glm::mat4 model_view_projection;
+	glm::mat4 model_view;
+	glm::mat4 matrix_normal;
+	// xyz no espaco do objeto.
+	glm::vec4 camera_object_position;
+	glm::vec2 relief_range;
+	float relief_exaggeration;
+	float lod_grid_resolution;
+	std::int32_t sphere_resolution;
+	std::int32_t padding[3];
+};
+
+static_assert(sizeof(FrameData) == 160, "FrameData fora do layout std140");
+static_assert(sizeof(ObjectData) == 240, "ObjectData fora do layout std140");
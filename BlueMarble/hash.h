@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// FNV-1a de 64 bits, usado nas chaves dos caches em cache/ (malhas e
+// programas). Comeca de fnv1a_offset_basis e encadeia: o hash de uma parte e
+// a semente da seguinte.
+constexpr std::uint64_t fnv1a_offset_basis = 14695981039346656037ull;
+
+inline std::uint64_t fnv1a(const void* data, size_t size, std::uint64_t hash) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t index = 0; index < size; index++) {
+		hash ^= bytes[index];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
@@ -3,6 +3,11 @@
 #include <array>
 #include <fstream>
 #include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sstream>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -13,136 +18,162 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include "elevation.h"
+#include "globe_layers.h"
+#include "globe_uniforms.h"
+#include "globe_lod.h"
+#include "mapped_file.h"
+#include "mesh_cache.h"
+#include "mesh_chunks.h"
+#include "shader_compiler.h"
+#include "shader_reload.h"
+#include "shader_variants.h"
+#include "sphere_pipeline.h"
+#include "texture_bake.h"
+#include "texture_cubemap.h"
+#include "texture_manager.h"
+#include "uniform_buffer.h"
+#include "virtual_texture.h"
+
 const int width = 800;
 const int height = 600;
 bool b_enable_mouse_movement = false;
 glm::vec2 previous_cursor{ 0.0f, 0.0f };
-
-struct directionalLight {
-	glm::vec3 direction;
-	GLfloat intensity;
+GLuint procedural_resolution = 50;
+float relief_exaggeration = 10.0f;
+bool print_texture_stats = false;
+
+struct AppOptions {
+	SphereMeshDesc sphere_mesh;
+	bool mesh_cache = true;
+	// Programas linkados guardados em cache/ (shader_cache.h).
+	bool shader_cache = true;
+	// Recompila os programas quando algo em shaders/ muda (shader_reload.h).
+	bool shader_reload = true;
+	bool procedural_sphere = false;
+	bool lod_sphere = false;
+	float lod_target_pixels = 8.0f;
+	// Heightmap equiretangular de 16 bits (--heightmap); o repositorio nao
+	// traz nenhum, entao o globo e liso a menos que um seja passado.
+	std::string heightmap_file;
+	// Imagem da Terra; tambem aceita uma piramide .bmvt, decodificada em
+	// paralelo.
+	std::string texture_file = "textures/earth_2k.jpg";
+	// Dia, noite, nuvens e mascara especular em uma textura array; o dia e
+	// texture_file.
+	bool globe_layers = false;
+	GlobeLayerFiles layer_files;
+	// Dia reprojetado em cubemap (texture_cubemap.h).
+	bool cubemap = false;
+	bool compress_textures = true;
+	// Brilho especular (variante SPECULAR) e o expoente de Phong.
+	bool specular = true;
+	float specular_exponent = 100.0f;
+	TextureManager::UploadBudget upload_budget;
+	// Orcamento de VRAM das texturas em MB (0 = sem limite).
+	size_t texture_budget_mb = 0;
+	// Prepara os containers de textura em cache/ e sai sem abrir janela.
+	bool bake_textures = false;
+	// Piramide .bmvt usada no lugar da textura da Terra (vazio = desligado).
+	std::string virtual_texture_file;
+	// Gera cache/<nome>.bmvt a partir destas imagens (partes em ordem de
+	// linhas, bake_columns por linha) e sai.
+	std::vector<std::string> bake_virtual_texture;
+	std::uint32_t bake_columns = 1;
 };
 
-std::string readFile(const char* file_path) {
-	std::string file_contents;
-	if (std::ifstream file_stream{ file_path, std::ios::in }) {
-		file_contents.assign(
-			std::istreambuf_iterator<char>(file_stream),
-			std::istreambuf_iterator<char>()
-		);
-	};
-
-	return file_contents;
-}
-
-void checkShader(GLuint shader_id) {
-	GLint result = GL_TRUE;
-	glGetShaderiv(shader_id, GL_COMPILE_STATUS, &result);
-
-	if (result == GL_FALSE) {
-		GLint info_log_length = 0;
-		glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &info_log_length);
-
-		if (info_log_length > 0) {
-			std::string shader_info_log(info_log_length, '\0');
-			glGetShaderInfoLog(shader_id, info_log_length, nullptr, &shader_info_log[0]);
-
-			std::cout << "Erro no shader" << std::endl;
-			std::cout << shader_info_log << std::endl;
-
-			assert(false);
+AppOptions parseOptions(int argc, char** argv) {
+	AppOptions options;
+
+	for (int arg = 1; arg < argc; arg++) {
+		const std::string name = argv[arg];
+		const bool has_value = arg + 1 < argc;
+
+		if (name == "--topology" && has_value) {
+			if (!parseSphereTopology(argv[++arg], options.sphere_mesh.topology)) {
+				std::cout << "Topologia invalida - " << argv[arg]
+					<< " (use uv, ico ou cube)" << std::endl;
+			}
+		} else if (name == "--resolution" && has_value) {
+			options.sphere_mesh.resolution = std::max(2, std::atoi(argv[++arg]));
+		} else if (name == "--vertex-format" && has_value) {
+			if (!parseVertexFormat(argv[++arg], options.sphere_mesh.vertex_format)) {
+				std::cout << "Formato de vertice invalido - " << argv[arg]
+					<< " (use full ou packed)" << std::endl;
+			}
+		} else if (name == "--index-format" && has_value) {
+			if (!parseIndexFormat(argv[++arg], options.sphere_mesh.index_format)) {
+				std::cout << "Formato de indice invalido - " << argv[arg]
+					<< " (use u32, u16 ou strip)" << std::endl;
+			}
+		} else if (name == "--procedural") {
+			options.procedural_sphere = true;
+		} else if (name == "--lod") {
+			options.lod_sphere = true;
+		} else if (name == "--lod-pixels" && has_value) {
+			options.lod_target_pixels = std::max(1.0f, static_cast<float>(std::atof(argv[++arg])));
+		} else if (name == "--heightmap" && has_value) {
+			options.heightmap_file = argv[++arg];
+		} else if (name == "--relief" && has_value) {
+			relief_exaggeration = std::max(0.0f, static_cast<float>(std::atof(argv[++arg])));
+		} else if (name == "--bake") {
+			options.bake_textures = true;
+		} else if (name == "--virtual-texture" && has_value) {
+			options.virtual_texture_file = argv[++arg];
+		} else if (name == "--bake-virtual" && has_value) {
+			std::stringstream parts{ argv[++arg] };
+			std::string part;
+			while (std::getline(parts, part, ',')) {
+				options.bake_virtual_texture.push_back(part);
+			}
+		} else if (name == "--bake-columns" && has_value) {
+			options.bake_columns = static_cast<std::uint32_t>(std::max(1, std::atoi(argv[++arg])));
+		} else if (name == "--texture" && has_value) {
+			options.texture_file = argv[++arg];
+		} else if (name == "--cubemap") {
+			options.cubemap = true;
+		} else if (name == "--layers") {
+			options.globe_layers = true;
+		} else if (name == "--night" && has_value) {
+			options.layer_files[GlobeLayer::Night] = argv[++arg];
+			options.globe_layers = true;
+		} else if (name == "--clouds" && has_value) {
+			options.layer_files[GlobeLayer::Clouds] = argv[++arg];
+			options.globe_layers = true;
+		} else if (name == "--specular" && has_value) {
+			options.layer_files[GlobeLayer::Specular] = argv[++arg];
+			options.globe_layers = true;
+		} else if (name == "--upload-kb" && has_value) {
+			options.upload_budget.bytes = static_cast<size_t>(std::max(1, std::atoi(argv[++arg]))) * 1024;
+		} else if (name == "--upload-ms" && has_value) {
+			options.upload_budget.milliseconds = std::max(0.0, std::atof(argv[++arg]));
+		} else if (name == "--texture-budget-mb" && has_value) {
+			options.texture_budget_mb = static_cast<size_t>(std::max(0, std::atoi(argv[++arg])));
+		} else if (name == "--shininess" && has_value) {
+			options.specular_exponent = std::max(1.0f, static_cast<float>(std::atof(argv[++arg])));
+		} else if (name == "--no-specular") {
+			options.specular = false;
+		} else if (name == "--no-compress") {
+			options.compress_textures = false;
+		} else if (name == "--no-optimize") {
+			options.sphere_mesh.optimize = false;
+		} else if (name == "--no-mesh-cache") {
+			options.mesh_cache = false;
+		} else if (name == "--no-shader-cache") {
+			options.shader_cache = false;
+		} else if (name == "--no-shader-reload") {
+			options.shader_reload = false;
+		} else {
+			std::cout << "Opcao desconhecida - " << name << std::endl;
 		}
 	}
-}
-
-GLuint loadShader(const char* vertex_shader_file,
-				 const char* fragment_shader_file) {
-
-	std::string vertex_shader_source = readFile("shaders/triangle_vert.glsl");
-	std::string fragment_shader_source = readFile("shaders/triangle_frag.glsl");
-
-	assert(!vertex_shader_source.empty());
-	assert(!fragment_shader_source.empty());
-
-	GLuint vertex_shader_id = glCreateShader(GL_VERTEX_SHADER);
-	GLuint fragment_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
-
-	const char* vertex_shader_pt = vertex_shader_source.c_str();
-	const char* fragment_shader_pt = fragment_shader_source.c_str();
-
-	glShaderSource(vertex_shader_id, 1, &vertex_shader_pt, nullptr);
-	glCompileShader(vertex_shader_id);
-	checkShader(vertex_shader_id);
-
-	glShaderSource(fragment_shader_id, 1, &fragment_shader_pt, nullptr);
-	glCompileShader(fragment_shader_id);
-	checkShader(fragment_shader_id);
-
-	GLuint program_id = glCreateProgram();
-	glAttachShader(program_id, vertex_shader_id);
-	glAttachShader(program_id, fragment_shader_id);
-	glLinkProgram(program_id);
-
-	GLint result = GL_TRUE;
-	glGetProgramiv(program_id, GL_LINK_STATUS, &result);
-
-	if (result == GL_FALSE) {
-		std::cout << "Erro ao linkar programa" << std::endl;
-		assert(false);
-	}
-
-	glDetachShader(program_id, vertex_shader_id);
-	glDetachShader(program_id, fragment_shader_id);
-
-	glDeleteShader(vertex_shader_id);
-	glDeleteShader(fragment_shader_id);
 
-	return program_id;
+	return options;
 }
 
-GLuint loadTexture(const char* texture_file) {
-	std::cout << "Carregando texture ... " << texture_file << std::endl;
-
-	//stbi_set_flip_vertically_on_load(true);
-
-	int texture_width = 0;
-	int texture_height = 0;
-	int number_of_components = 0;
-	
-	unsigned char* texture_data = stbi_load(texture_file, &texture_width,
-		&texture_height, &number_of_components,
-		3
-	);
-
-	assert(texture_data);
-
-	GLuint texture_id;
-	glGenTextures(1, &texture_id);
-	glBindTexture(GL_TEXTURE_2D, texture_id);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, texture_width, 
-		texture_height, 0, GL_RGB, GL_UNSIGNED_BYTE,
-		texture_data
-	);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	glGenerateMipmap(GL_TEXTURE_2D);
-
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	stbi_image_free(texture_data);
-
-	return texture_id;
-}
-
-struct vertex {
-	glm::vec3 position;
-	glm::vec3 normal;
-	glm::vec3 color;
-	glm::vec2 uv;
+struct directionalLight {
+	glm::vec3 direction;
+	GLfloat intensity;
 };
 
 class FlyCamera {
@@ -188,6 +219,10 @@ public:
 		return glm::lookAt(location, location + direction, up);
 	}
 
+	glm::mat4 getProjection() const {
+		return glm::perspective(fov, aspect_ratio, near, far);
+	}
+
 	float speed = 10.0f;
 	float sensivity = 1.0f;
 
@@ -239,6 +274,32 @@ void mouseMotionCallback(GLFWwindow* window, double x, double y) {
 	}
 }
 
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int modifiers) {
+	if (action != GLFW_PRESS && action != GLFW_REPEAT) {
+		return;
+	}
+
+	if (key == GLFW_KEY_EQUAL) {
+		procedural_resolution = std::min<GLuint>(procedural_resolution * 2, 16384);
+		std::cout << "Resolucao procedural - " << procedural_resolution << std::endl;
+	}
+	if (key == GLFW_KEY_MINUS) {
+		procedural_resolution = std::max<GLuint>(procedural_resolution / 2, 2);
+		std::cout << "Resolucao procedural - " << procedural_resolution << std::endl;
+	}
+	if (key == GLFW_KEY_RIGHT_BRACKET) {
+		relief_exaggeration = std::min(std::max(relief_exaggeration * 2.0f, 1.0f), 1024.0f);
+		std::cout << "Exagero do relevo - " << relief_exaggeration << std::endl;
+	}
+	if (key == GLFW_KEY_LEFT_BRACKET) {
+		relief_exaggeration = relief_exaggeration > 1.0f ? relief_exaggeration * 0.5f : 0.0f;
+		std::cout << "Exagero do relevo - " << relief_exaggeration << std::endl;
+	}
+	if (key == GLFW_KEY_T) {
+		print_texture_stats = true;
+	}
+}
+
 GLuint loadGeometry() {
 	std::array<vertex, 6> quad{
 		vertex{ glm::vec3{ -1.0f, -1.0f, 0.0f},
@@ -317,116 +378,122 @@ GLuint loadGeometry() {
 
 }
 
-void generateSphereMesh(GLuint resolution, 
-					std::vector<vertex>& vertex_buf,
-					std::vector<glm::ivec3>& indices
-					) {
-	vertex_buf.clear();
-	indices.clear();
-
-	constexpr float pi = glm::pi<float>();
-	constexpr float two_pi = glm::two_pi<float>();
-	const float inv_resolution = 1.0f / static_cast<float>(resolution - 1);
-
-	for (GLuint u_index = 0; u_index < resolution; u_index++) {
-		const float u = u_index * inv_resolution;
-		const float theta = glm::mix(0.0f, pi, u);
-		for (GLuint v_index = 0; v_index < resolution; v_index++) {
-			const float v = v_index * inv_resolution;
-			const float phi = glm::mix(0.0f, two_pi, v);
-
-			glm::vec3 vertex_position = {
-				glm::sin(theta) * glm::cos(phi),
-				glm::sin(theta) * glm::sin(phi),
-				glm::cos(theta)
-			};
-
-			vertex vertice{
-				vertex_position,
-				glm::normalize(vertex_position),
-				glm::vec3{1.0f, 1.0f, 1.0f},
-				glm::vec2{v, u}
-			};
-			
-			vertex_buf.push_back(vertice);
+struct SphereMesh {
+	GLuint vao = 0;
+	GLuint num_vertices = 0;
+	GLuint num_indices = 0;
+	GLenum primitive = GL_TRIANGLES;
+	GLenum index_type = GL_UNSIGNED_INT;
+	std::vector<MeshChunk> chunks;
+};
+
+SphereMesh loadSphere(const AppOptions& options) {
+	const SphereMeshDesc& desc = options.sphere_mesh;
+
+	// A malha sempre vai direto para os buffers GL mapeados. Com o cache os
+	// bytes sao copiados do arquivo mapeado; se ele faltar ou estiver
+	// desatualizado a malha e gerada nos buffers e gravada a partir deles.
+	SphereMeshLayout layout;
+	BufferMeshSink sink;
+	MappedFile cache_file;
+	SphereMeshView view;
+
+	if (options.mesh_cache && loadCachedSphereMesh(desc, cache_file, view)) {
+		layout = view;
+		std::memcpy(sink.vertices(view.vertex_bytes), view.vertex_data, view.vertex_bytes);
+		std::memcpy(sink.indices(view.index_bytes), view.index_data, view.index_bytes);
+		sink.finish();
+		cache_file.close();
+	} else {
+		buildSphereMesh(desc, sink, layout);
+		if (options.mesh_cache) {
+			storeCachedSphereMesh(desc, layout, sink.vertexBuffer(), sink.elementBuffer());
 		}
 	}
 
-	for (GLuint u = 0; u < resolution - 1; u++) {
-		for (GLuint v = 0; v < resolution - 1; v++) {
-			GLuint p0 = u + v * resolution;
-			GLuint p1 = (u + 1) + v * resolution;
-			GLuint p2 = (u + 1) + (v + 1) * resolution;
-			GLuint p3 = u + (v + 1) * resolution;
+	const GLuint vertex_buffer = sink.vertexBuffer();
+	const GLuint element_buffer = sink.elementBuffer();
 
-			indices.push_back(glm::ivec3{ p0, p1, p3 });
-			indices.push_back(glm::ivec3{ p3, p1, p2 });
-		}
-	}
-}
+	SphereMesh mesh;
+	mesh.num_vertices = layout.num_vertices;
+	mesh.num_indices = layout.num_indices;
+	mesh.primitive = layout.primitive;
+	mesh.index_type = layout.index_type;
+	mesh.chunks = layout.chunks;
 
-GLuint loadSphere(GLuint &num_vertices, GLuint &num_indices) {
-	std::vector<vertex> vertices;
-	std::vector<glm::ivec3> triangles;
-	generateSphereMesh(50, vertices, triangles);
+	const size_t vertex_stride = vertexFormatStride(desc.vertex_format);
+	const size_t index_stride = layout.index_type == GL_UNSIGNED_SHORT ?
+		sizeof(GLushort) : sizeof(GLuint);
 
-	std::cout << vertices.data() << std::endl;
+	std::cout << "Formato de vertice - " << vertexFormatName(desc.vertex_format)
+		<< " (" << vertex_stride << " bytes, "
+		<< layout.num_vertices * vertex_stride / 1024 << " KB de vertices)" << std::endl;
+	std::cout << "Formato de indice - " << indexFormatName(desc.index_format)
+		<< " (" << layout.num_indices * index_stride / 1024 << " KB de indices)" << std::endl;
 
-	num_vertices = vertices.size();
-	num_indices = triangles.size() * 3;
+	glGenVertexArrays(1, &mesh.vao);
+	glBindVertexArray(mesh.vao);
 
-	GLuint vertex_buffer;
-	glGenBuffers(1, &vertex_buffer);
 	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertex),
-		vertices.data(), GL_STATIC_DRAW
-	);
-
-	GLuint element_buffer;
-	glGenBuffers(1, &element_buffer);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_buffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, triangles.size() * sizeof(glm::ivec3),
-		triangles.data(), GL_STATIC_DRAW
-	);
-
-
-	GLuint vao;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
 
-	glEnableVertexAttribArray(0);
-	glEnableVertexAttribArray(1);
-	glEnableVertexAttribArray(2);
-	glEnableVertexAttribArray(3);
+	setupVertexFormat(desc.vertex_format);
 
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
+	glBindVertexArray(0);
 
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_buffer);
+	return mesh;
+}
 
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), nullptr);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_TRUE, sizeof(vertex),
-		reinterpret_cast<void*>(offsetof(vertex, normal))
-	);
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_TRUE, sizeof(vertex),
-		reinterpret_cast<void*>(offsetof(vertex, color))
-	);
-	glVertexAttribPointer(3, 3, GL_FLOAT, GL_TRUE, sizeof(vertex),
-		reinterpret_cast<void*>(offsetof(vertex, uv))
-	);
+void drawSphereMesh(const SphereMesh& mesh) {
+	const bool restart = mesh.primitive == GL_TRIANGLE_STRIP;
+	if (restart) {
+		glEnable(GL_PRIMITIVE_RESTART);
+		glPrimitiveRestartIndex(primitive_restart_index);
+	}
 
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	for (const MeshChunk& chunk : mesh.chunks) {
+		glDrawElementsBaseVertex(mesh.primitive, chunk.index_count, mesh.index_type,
+			reinterpret_cast<void*>(chunk.index_offset), chunk.base_vertex);
+	}
 
-	glBindVertexArray(0);
-	glDisableVertexAttribArray(3);
-	glDisableVertexAttribArray(2);
-	glDisableVertexAttribArray(1);
-	glDisableVertexAttribArray(0);
+	if (restart) {
+		glDisable(GL_PRIMITIVE_RESTART);
+	}
+}
 
+// A esfera procedural nao tem buffers: triangle_vert.glsl calcula posicao,
+// normal e uv a partir de gl_VertexID. O perfil core exige um VAO ligado,
+// mesmo vazio.
+GLuint loadProceduralSphere() {
+	GLuint vao;
+	glGenVertexArrays(1, &vao);
 	return vao;
 }
 
-int main() {
+// Uma triangle strip por linha da grade UV, ligadas por dois vertices
+// degenerados (mesma conta usada em triangle_vert.glsl).
+GLsizei proceduralSphereVertexCount(GLuint resolution) {
+	return static_cast<GLsizei>((resolution - 1) * (2 * resolution + 2));
+}
+
+int main(int argc, char** argv) {
+
+	const AppOptions options = parseOptions(argc, argv);
+
+	if (options.bake_textures) {
+		const bool baked = options.cubemap ?
+			bakeCubemapContainers(options.texture_file, options.compress_textures) :
+			bakeTextureContainer(options.texture_file, options.compress_textures);
+		return baked ? 0 : 1;
+	}
+
+	if (!options.bake_virtual_texture.empty()) {
+		const bool built = buildVirtualTexture(options.bake_virtual_texture,
+			options.bake_columns, virtualTexturePath(options.bake_virtual_texture[0]));
+		return built ? 0 : 1;
+	}
 
 	glfwInit();
 
@@ -436,6 +503,7 @@ int main() {
 
 	glfwSetMouseButtonCallback(window, mouseButtonCallback);
 	glfwSetCursorPosCallback(window, mouseMotionCallback);
+	glfwSetKeyCallback(window, keyCallback);
 
 	glfwMakeContextCurrent(window);
 	glfwSwapInterval(1);
@@ -454,12 +522,102 @@ int main() {
 	std::cout << std::endl << vertex_shader_source;
 	std::cout << std::endl << fragment_shader_source << std::endl;
 
-	GLuint program_id = loadShader(
-		vertex_shader_source.c_str(),
-		fragment_shader_source.c_str()
-	);
+	// Compila em segundo plano; o globo aparece quando a variante fica pronta.
+	// Unidades de textura e blocos fixos: o render loop nao chama glUniform.
+	ProgramBindings program_bindings;
+	program_bindings.samplers = {
+		{ "texture_sampler", 0 }, { "height_sampler", 1 }, { "slope_sampler", 2 },
+		{ "vt_atlas", 3 }, { "vt_page_table", 4 }, { "layer_sampler", 5 },
+		{ "cube_sampler", 6 }
+	};
+	program_bindings.blocks = {
+		{ "FrameData", frame_data_binding }, { "ObjectData", object_data_binding }
+	};
+
+	ShaderCompiler shader_compiler;
+	shader_compiler.initialize(options.shader_cache, program_bindings);
+
+	UniformBuffer frame_uniforms;
+	frame_uniforms.initialize(frame_data_binding, sizeof(FrameData));
+	UniformBuffer object_uniforms;
+	object_uniforms.initialize(object_data_binding, sizeof(ObjectData));
+
+	ShaderVariants globe_shaders(shader_compiler, vertex_shader_source,
+		fragment_shader_source);
+
+	ShaderReloader shader_reloader;
+	if (options.shader_reload) {
+		shader_reloader.start(window, "shaders");
+	}
+
+	TextureManager texture_manager;
+	texture_manager.setCompression(options.compress_textures);
+	texture_manager.setUploadBudget(options.upload_budget);
+	texture_manager.setMemoryBudget(options.texture_budget_mb * 1024 * 1024);
+
+	GlobeLayers globe_layers;
+	if (options.globe_layers) {
+		GlobeLayerFiles layer_files = options.layer_files;
+		layer_files[GlobeLayer::Day] = options.texture_file;
+		globe_layers = loadGlobeLayers(texture_manager, layer_files);
+	}
+
+	GLuint cube_texture_id = 0;
+	if (options.cubemap) {
+		cube_texture_id = texture_manager.loadCubemap(options.texture_file);
+		glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+	}
+
+	// Com as camadas o dia vai na array; com o cubemap, nas faces.
+	GLuint texture_id = globe_layers.texture_array != 0 || cube_texture_id != 0 ? 0 :
+		texture_manager.load(options.texture_file);
+	ElevationMaps elevation = loadElevation(options.heightmap_file.c_str());
+
+	VirtualTexture virtual_texture;
+	bool virtual_texture_enabled = false;
+	if (!options.virtual_texture_file.empty()) {
+		virtual_texture_enabled = virtual_texture.initialize(
+			options.virtual_texture_file, width, height, VirtualTexture::Settings{});
+	}
+
+	// Variante do globo para esta configuracao; pedir ja aqui poe a compilacao
+	// em paralelo com a carga da malha.
+	ShaderFeatures globe_features = 0;
+	if (options.lod_sphere) {
+		globe_features |= shaderFeatureBit(ShaderFeature::LodPatch) |
+			shaderFeatureBit(ShaderFeature::SphericalUV);
+	} else if (options.procedural_sphere) {
+		globe_features |= shaderFeatureBit(ShaderFeature::ProceduralSphere);
+	} else if (options.sphere_mesh.vertex_format == VertexFormat::Packed) {
+		globe_features |= shaderFeatureBit(ShaderFeature::PackedVertex);
+	}
 
-	GLuint texture_id = loadTexture("textures/earth_2k.jpg");
+	// O feedback so precisa da geometria e do uv.
+	const ShaderFeatures feedback_features = globe_features |
+		shaderFeatureBit(ShaderFeature::VirtualFeedback);
+
+	if (options.specular) {
+		globe_features |= shaderFeatureBit(ShaderFeature::Specular);
+	}
+	if (globe_layers.texture_array != 0) {
+		globe_features |= shaderFeatureBit(ShaderFeature::GlobeLayers);
+		if (globe_layers.has(GlobeLayer::Night)) {
+			globe_features |= shaderFeatureBit(ShaderFeature::NightLayer);
+		}
+		if (globe_layers.has(GlobeLayer::Clouds)) {
+			globe_features |= shaderFeatureBit(ShaderFeature::CloudLayer);
+		}
+		if (globe_layers.has(GlobeLayer::Specular)) {
+			globe_features |= shaderFeatureBit(ShaderFeature::SpecularLayer);
+		}
+	}
+	if (virtual_texture_enabled) {
+		globe_features |= shaderFeatureBit(ShaderFeature::VirtualTexture);
+		globe_shaders.program(feedback_features);
+	} else if (cube_texture_id != 0) {
+		globe_features |= shaderFeatureBit(ShaderFeature::CubeTexture);
+	}
+	globe_shaders.program(globe_features);
 	glm::mat4 matrix_model = glm::rotate(
 								glm::identity<glm::mat4>(),
 								glm::radians(270.0f),
@@ -474,14 +632,25 @@ int main() {
 
 	//GLuint quad_vao = loadGeometry();
 
-	GLuint sphere_num_vertices = 0;
-	GLuint sphere_num_indices = 0;
-	GLuint sphere_vao = loadSphere(sphere_num_vertices, sphere_num_indices);
+	SphereMesh sphere;
+	GlobeLod globe_lod;
+	procedural_resolution = options.sphere_mesh.resolution;
+
+	if (options.lod_sphere) {
+		GlobeLod::Settings lod_settings;
+		lod_settings.target_edge_pixels = options.lod_target_pixels;
+		globe_lod.initialize(lod_settings);
+	} else if (options.procedural_sphere) {
+		sphere.vao = loadProceduralSphere();
+		sphere.num_vertices = proceduralSphereVertexCount(procedural_resolution);
+	} else {
+		sphere = loadSphere(options);
+	}
 
-	std::cout << "Numero de vertices - " << sphere_num_vertices <<
+	std::cout << "Numero de vertices - " << sphere.num_vertices <<
 		std::endl;
 
-	std::cout << "Numero de indices - " << sphere_num_indices <<
+	std::cout << "Numero de indices - " << sphere.num_indices <<
 		std::endl;
 
 
@@ -489,12 +658,55 @@ int main() {
 
 	double previous_time = glfwGetTime();
 
+	size_t shown_lod_triangles = 0;
+
+	// Programas que ja receberam os uniforms da textura virtual; um programa
+	// recarregado tem outro id e e configurado de novo.
+	GLuint configured_feedback_program = 0;
+	GLuint configured_globe_program = 0;
+
 	directionalLight light;
 	light.direction = glm::vec3{ 0.0f, 0.0f, -1.0f };
 	light.intensity = 1.0f;
 
+	auto drawGlobe = [&]() {
+		glBindVertexArray(sphere.vao);
+
+		glPointSize(1.0f);
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+		//glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+		if (options.lod_sphere) {
+			globe_lod.draw();
+		} else if (options.procedural_sphere) {
+			glDrawArrays(GL_TRIANGLE_STRIP, 0,
+				proceduralSphereVertexCount(procedural_resolution));
+		} else {
+			drawSphereMesh(sphere);
+		}
+		//glDrawArrays(GL_POINTS, 0, sphere.num_vertices);
+
+		glBindVertexArray(0);
+	};
+
 	while (!glfwWindowShouldClose(window)) {
 
+		texture_manager.update();
+		if (print_texture_stats) {
+			print_texture_stats = false;
+			const TextureManager::Stats& stats = texture_manager.stats();
+			std::cout << "Texturas - " << stats.textures << " (" << stats.streaming
+				<< " em streaming, " << stats.reduced << " reduzidas), "
+				<< stats.resident_bytes / 1024 << " KB residentes, pico "
+				<< stats.peak_bytes / 1024 << " KB, orcamento "
+				<< stats.budget_bytes / 1024 << " KB, " << stats.uploaded_levels
+				<< " niveis enviados, " << stats.dropped_levels << " descartados"
+				<< std::endl;
+		}
+		if (virtual_texture_enabled) {
+			virtual_texture.update();
+		}
+
 		glEnable(GL_DEPTH_TEST);
 
 		double current_time = glfwGetTime();
@@ -510,54 +722,103 @@ int main() {
 		}
 		
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glUseProgram(program_id);
 
-		glm::mat4 matrix_normal = glm::inverse(glm::transpose(camera.getView() * matrix_model));
+		shader_compiler.update();
+		shader_reloader.update(shader_compiler);
+
+		glm::mat4 matrix_model_view = camera.getView() * matrix_model;
+		glm::mat4 matrix_normal = glm::inverse(glm::transpose(matrix_model_view));
 		glm::mat4 view_projection = camera.getViewProjection();
 		glm::mat4 matrix_model_view_projection = view_projection * matrix_model;
 
-		GLint model_view_projection_loc =
-			glGetUniformLocation(program_id, "model_view_projection");
+		const glm::vec3 camera_object_position =
+			glm::inverse(matrix_model) * glm::vec4{ camera.location, 1.0f };
 
-		glUniformMatrix4fv(model_view_projection_loc, 1, GL_FALSE,
-			glm::value_ptr(matrix_model_view_projection)
-		);
+		if (options.lod_sphere) {
+			globe_lod.setMaxDisplacement(relief_exaggeration * elevation.height_range.y);
 
-		GLint normal_loc =
-			glGetUniformLocation(program_id, "matrix_normal");
+			globe_lod.select(camera_object_position, matrix_model_view_projection,
+				static_cast<float>(height), camera.fov);
 
-		glUniformMatrix4fv(normal_loc, 1, GL_FALSE,
-			glm::value_ptr(matrix_normal)
-		);
+			if (globe_lod.stats().triangles != shown_lod_triangles) {
+				shown_lod_triangles = globe_lod.stats().triangles;
+				const std::string title = "Hello opengl! - LOD " +
+					std::to_string(globe_lod.stats().patches) + " patches, " +
+					std::to_string(shown_lod_triangles) + " triangulos, nivel " +
+					std::to_string(globe_lod.stats().deepest_level);
+				glfwSetWindowTitle(window, title.c_str());
+			}
+		}
 
-		GLint light_direction_loc =
-			glGetUniformLocation(program_id, "light_direction");
+		// Dados do quadro e do globo: duas escritas de buffer, vistas por
+		// todas as variantes pelos bindings fixos dos blocos.
+		FrameData frame_data{};
+		frame_data.view = camera.getView();
+		frame_data.projection = camera.getProjection();
+		frame_data.light_direction = camera.getView() * glm::vec4{ light.direction, 0.0f };
+		frame_data.light_intensity = light.intensity;
+		frame_data.specular_exponent = options.specular_exponent;
+		frame_uniforms.update(&frame_data);
+
+		ObjectData object_data{};
+		object_data.model_view_projection = matrix_model_view_projection;
+		object_data.model_view = matrix_model_view;
+		object_data.matrix_normal = matrix_normal;
+		object_data.camera_object_position = glm::vec4{ camera_object_position, 1.0f };
+		object_data.relief_range = elevation.height_range;
+		object_data.relief_exaggeration = relief_exaggeration;
+		object_data.lod_grid_resolution = static_cast<float>(globe_lod.gridResolution());
+		object_data.sphere_resolution = static_cast<std::int32_t>(procedural_resolution);
+		object_uniforms.update(&object_data);
 
-		glUniform3fv(light_direction_loc, 1, glm::value_ptr(
-			camera.getView() * glm::vec4{ light.direction, 0.0f }
-			)
-		);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, texture_id);
+		texture_manager.touch(texture_id);
 
-		GLint light_intensity_loc =
-			glGetUniformLocation(program_id, "light_intensity");
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, elevation.height_texture);
 
-		glUniform1f(light_intensity_loc, light.intensity);
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_2D, elevation.slope_texture);
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture_id);
-		GLint texture_sampler_loc = glGetUniformLocation(program_id, "texture_sampler");
-		glUniform1i(texture_sampler_loc, 0);
+		glActiveTexture(GL_TEXTURE5);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, globe_layers.texture_array);
+		texture_manager.touch(globe_layers.texture_array);
 
-		glBindVertexArray(sphere_vao);
+		glActiveTexture(GL_TEXTURE6);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, cube_texture_id);
+		texture_manager.touch(cube_texture_id);
 
-		glPointSize(1.0f);
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		glActiveTexture(GL_TEXTURE0);
 
-		//glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
-		glDrawElements(GL_TRIANGLES, sphere_num_indices, GL_UNSIGNED_INT, nullptr);
-		//glDrawArrays(GL_POINTS, 0, sphere_num_vertices);
+		// Passe de feedback em baixa resolucao: diz quais paginas da
+		// textura virtual este quadro usa (lidas dois quadros depois).
+		if (virtual_texture_enabled) {
+			virtual_texture.bindTextures(3, 4);
+
+			const ShaderProgram* feedback_program = globe_shaders.program(feedback_features);
+			if (feedback_program != nullptr) {
+				glUseProgram(feedback_program->id());
+				if (feedback_program->id() != configured_feedback_program) {
+					virtual_texture.configure(*feedback_program, true);
+					configured_feedback_program = feedback_program->id();
+				}
+				virtual_texture.beginFeedback();
+				drawGlobe();
+				virtual_texture.endFeedback(width, height);
+			}
+		}
 
-		glBindVertexArray(0);
+		// Enquanto a variante compila o quadro sai so com a cor de fundo.
+		const ShaderProgram* globe_program = globe_shaders.program(globe_features);
+		if (globe_program != nullptr) {
+			glUseProgram(globe_program->id());
+			if (virtual_texture_enabled && globe_program->id() != configured_globe_program) {
+				virtual_texture.configure(*globe_program, false);
+				configured_globe_program = globe_program->id();
+			}
+			drawGlobe();
+		}
 		glUseProgram(0);
 
 		glfwPollEvents();
@@ -580,6 +841,21 @@ int main() {
 
 	//glDeleteVertexArrays(1, &quad_vao);
 
+	if (options.lod_sphere) {
+		globe_lod.release();
+	}
+
+	if (virtual_texture_enabled) {
+		virtual_texture.release();
+	}
+
+	releaseElevation(elevation);
+	texture_manager.release();
+	shader_reloader.release();
+	shader_compiler.release();
+	object_uniforms.release();
+	frame_uniforms.release();
+
 	glfwTerminate();
 
 	return 0;
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Arquivo somente leitura mapeado em memoria (mmap / CreateFileMapping).
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const { return mapped_data != nullptr; }
+	const unsigned char* data() const { return static_cast<const unsigned char*>(mapped_data); }
+	size_t size() const { return mapped_size; }
+
+private:
+	void* mapped_data = nullptr;
+	size_t mapped_size = 0;
+#ifdef _WIN32
+	void* file_handle = nullptr;
+	void* mapping_handle = nullptr;
+#endif
+};
@@ -0,0 +1,259 @@
+#include "mesh_cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "hash.h"
+
+namespace {
+
+constexpr char mesh_cache_magic[8] = { 'B', 'M', 'M', 'E', 'S', 'H', '\0', '\0' };
+constexpr std::uint32_t mesh_cache_file_version = 1;
+constexpr std::uint64_t mesh_cache_alignment = 4096;
+// Tamanho de cada leitura de volta dos buffers GL ao gravar o cache.
+constexpr size_t readback_block_bytes = 1 << 20;
+
+// Resolucao usada para a impressao digital do pipeline.
+constexpr GLuint fingerprint_resolution = 9;
+
+struct meshCacheHeader {
+	char magic[8];
+	std::uint32_t file_version;
+	std::uint32_t mesh_version;
+	std::uint64_t fingerprint;
+
+	std::uint32_t topology;
+	std::uint32_t resolution;
+	std::uint32_t vertex_format;
+	std::uint32_t index_format;
+	std::uint32_t optimize;
+
+	std::uint32_t primitive;
+	std::uint32_t index_type;
+	std::uint32_t num_vertices;
+	std::uint32_t num_indices;
+	std::uint32_t chunk_count;
+
+	std::uint64_t chunk_offset;
+	std::uint64_t vertex_offset;
+	std::uint64_t vertex_bytes;
+	std::uint64_t index_offset;
+	std::uint64_t index_bytes;
+};
+
+struct cachedChunk {
+	std::int32_t base_vertex;
+	std::int32_t index_count;
+	std::uint64_t index_offset;
+};
+
+std::uint64_t alignUp(std::uint64_t value) {
+	return (value + mesh_cache_alignment - 1) / mesh_cache_alignment * mesh_cache_alignment;
+}
+
+// Hash da malha gerada pelo pipeline atual em baixa resolucao com os mesmos
+// formatos e topologia. Muda sozinho quando o codigo dos geradores muda.
+std::uint64_t pipelineFingerprint(const SphereMeshDesc& desc) {
+	static std::map<std::tuple<int, int, int, bool>, std::uint64_t> fingerprints;
+
+	const auto key = std::make_tuple(static_cast<int>(desc.topology),
+		static_cast<int>(desc.vertex_format), static_cast<int>(desc.index_format),
+		desc.optimize);
+
+	auto found = fingerprints.find(key);
+	if (found != fingerprints.end()) {
+		return found->second;
+	}
+
+	SphereMeshDesc small_desc = desc;
+	small_desc.resolution = fingerprint_resolution;
+
+	SphereMeshData data;
+	buildSphereMeshData(small_desc, data, false);
+
+	std::uint64_t hash = fnv1a_offset_basis;
+	hash = fnv1a(data.vertex_data.data(), data.vertex_data.size(), hash);
+	hash = fnv1a(data.index_data.data(), data.index_data.size(), hash);
+	for (const MeshChunk& chunk : data.chunks) {
+		const cachedChunk stored{ chunk.base_vertex, chunk.index_count,
+								  static_cast<std::uint64_t>(chunk.index_offset) };
+		hash = fnv1a(&stored, sizeof(stored), hash);
+	}
+
+	fingerprints.emplace(key, hash);
+	return hash;
+}
+
+meshCacheHeader makeHeader(const SphereMeshDesc& desc) {
+	meshCacheHeader header{};
+	std::memcpy(header.magic, mesh_cache_magic, sizeof(header.magic));
+	header.file_version = mesh_cache_file_version;
+	header.mesh_version = sphere_mesh_version;
+	header.fingerprint = pipelineFingerprint(desc);
+	header.topology = static_cast<std::uint32_t>(desc.topology);
+	header.resolution = desc.resolution;
+	header.vertex_format = static_cast<std::uint32_t>(desc.vertex_format);
+	header.index_format = static_cast<std::uint32_t>(desc.index_format);
+	header.optimize = desc.optimize ? 1 : 0;
+	return header;
+}
+
+}
+
+std::string sphereMeshCachePath(const SphereMeshDesc& desc,
+					const std::string& directory) {
+	return directory + "/sphere_" + sphereTopologyName(desc.topology) + "_" +
+		std::to_string(desc.resolution) + "_" + vertexFormatName(desc.vertex_format) +
+		"_" + indexFormatName(desc.index_format) + (desc.optimize ? "_opt" : "") +
+		".mesh";
+}
+
+bool loadCachedSphereMesh(const SphereMeshDesc& desc, MappedFile& file,
+					SphereMeshView& view,
+					const std::string& directory) {
+	const std::string path = sphereMeshCachePath(desc, directory);
+	if (!file.open(path)) {
+		return false;
+	}
+
+	const meshCacheHeader expected = makeHeader(desc);
+
+	meshCacheHeader header;
+	bool valid = file.size() >= sizeof(header);
+	if (valid) {
+		std::memcpy(&header, file.data(), sizeof(header));
+
+		valid = std::memcmp(header.magic, expected.magic, sizeof(header.magic)) == 0 &&
+			header.file_version == expected.file_version &&
+			header.mesh_version == expected.mesh_version &&
+			header.fingerprint == expected.fingerprint &&
+			header.topology == expected.topology &&
+			header.resolution == expected.resolution &&
+			header.vertex_format == expected.vertex_format &&
+			header.index_format == expected.index_format &&
+			header.optimize == expected.optimize &&
+			header.chunk_offset + header.chunk_count * sizeof(cachedChunk) <= file.size() &&
+			header.vertex_offset + header.vertex_bytes <= file.size() &&
+			header.index_offset + header.index_bytes <= file.size();
+	}
+
+	if (!valid) {
+		std::cout << "Cache de malha desatualizado - " << path << std::endl;
+		file.close();
+		return false;
+	}
+
+	view.vertex_data = file.data() + header.vertex_offset;
+	view.vertex_bytes = header.vertex_bytes;
+	view.index_data = file.data() + header.index_offset;
+	view.index_bytes = header.index_bytes;
+	view.primitive = header.primitive;
+	view.index_type = header.index_type;
+	view.num_vertices = header.num_vertices;
+	view.num_indices = header.num_indices;
+
+	view.chunks.resize(header.chunk_count);
+	for (std::uint32_t index = 0; index < header.chunk_count; index++) {
+		cachedChunk stored;
+		std::memcpy(&stored, file.data() + header.chunk_offset + index * sizeof(cachedChunk),
+			sizeof(stored));
+		view.chunks[index].base_vertex = stored.base_vertex;
+		view.chunks[index].index_count = stored.index_count;
+		view.chunks[index].index_offset = static_cast<size_t>(stored.index_offset);
+	}
+
+	std::cout << "Malha carregada do cache - " << path << std::endl;
+	return true;
+}
+
+bool storeCachedSphereMesh(const SphereMeshDesc& desc, const SphereMeshLayout& layout,
+					GLuint vertex_buffer, GLuint element_buffer,
+					const std::string& directory) {
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+
+	const size_t index_size = layout.index_type == GL_UNSIGNED_SHORT ?
+		sizeof(GLushort) : sizeof(GLuint);
+
+	meshCacheHeader header = makeHeader(desc);
+	header.primitive = layout.primitive;
+	header.index_type = layout.index_type;
+	header.num_vertices = layout.num_vertices;
+	header.num_indices = layout.num_indices;
+	header.chunk_count = static_cast<std::uint32_t>(layout.chunks.size());
+
+	header.chunk_offset = alignUp(sizeof(header));
+	header.vertex_offset = alignUp(header.chunk_offset + layout.chunks.size() * sizeof(cachedChunk));
+	header.vertex_bytes = static_cast<std::uint64_t>(layout.num_vertices) *
+		vertexFormatStride(desc.vertex_format);
+	header.index_offset = alignUp(header.vertex_offset + header.vertex_bytes);
+	header.index_bytes = static_cast<std::uint64_t>(layout.num_indices) * index_size;
+
+	const std::string path = sphereMeshCachePath(desc, directory);
+	const std::string temporary_path = path + ".tmp";
+
+	{
+		std::ofstream stream{ temporary_path, std::ios::binary | std::ios::trunc };
+		if (!stream) {
+			std::cout << "Erro ao gravar cache de malha - " << path << std::endl;
+			return false;
+		}
+
+		auto padTo = [&stream](std::uint64_t offset) {
+			static const char zeros[mesh_cache_alignment] = {};
+			const std::uint64_t position = static_cast<std::uint64_t>(stream.tellp());
+			stream.write(zeros, static_cast<std::streamsize>(offset - position));
+		};
+
+		std::vector<char> block;
+		auto writeBuffer = [&stream, &block](GLuint buffer, std::uint64_t bytes) {
+			block.resize(static_cast<size_t>(std::min<std::uint64_t>(bytes, readback_block_bytes)));
+			glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+			for (std::uint64_t offset = 0; offset < bytes; offset += block.size()) {
+				const size_t size = static_cast<size_t>(
+					std::min<std::uint64_t>(bytes - offset, block.size()));
+				glGetBufferSubData(GL_COPY_READ_BUFFER, static_cast<GLintptr>(offset),
+					static_cast<GLsizeiptr>(size), block.data());
+				stream.write(block.data(), static_cast<std::streamsize>(size));
+			}
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		};
+
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		padTo(header.chunk_offset);
+		for (const MeshChunk& chunk : layout.chunks) {
+			const cachedChunk stored{ chunk.base_vertex, chunk.index_count,
+									  static_cast<std::uint64_t>(chunk.index_offset) };
+			stream.write(reinterpret_cast<const char*>(&stored), sizeof(stored));
+		}
+
+		padTo(header.vertex_offset);
+		writeBuffer(vertex_buffer, header.vertex_bytes);
+
+		padTo(header.index_offset);
+		writeBuffer(element_buffer, header.index_bytes);
+
+		if (!stream) {
+			std::cout << "Erro ao gravar cache de malha - " << path << std::endl;
+			return false;
+		}
+	}
+
+	// Troca atomica: uma execucao concorrente nunca mapeia um arquivo pela metade.
+	std::filesystem::rename(temporary_path, path, error);
+	if (error) {
+		std::filesystem::remove(path, error);
+		std::filesystem::rename(temporary_path, path, error);
+	}
+
+	return !error;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+#include "mapped_file.h"
+#include "sphere_pipeline.h"
+
+// Cache em disco das malhas geradas. Cada arquivo guarda um cabecalho
+// versionado seguido dos blocos, vertices e indices em secoes alinhadas a
+// pagina, prontos para serem mapeados e enviados ao GL sem copia.
+//
+// O cabecalho guarda sphere_mesh_version e uma impressao digital da saida
+// do pipeline em baixa resolucao; se qualquer um mudar, o arquivo e
+// descartado e a malha e gerada de novo.
+
+std::string sphereMeshCachePath(const SphereMeshDesc& desc,
+					const std::string& directory = "cache");
+
+// Mapeia o arquivo de cache de desc em file e preenche view apontando para a
+// memoria mapeada. Retorna false se nao existir ou estiver desatualizado.
+bool loadCachedSphereMesh(const SphereMeshDesc& desc, MappedFile& file,
+					SphereMeshView& view,
+					const std::string& directory = "cache");
+
+// Grava a malha que ja esta nos buffers GL, lendo-os de volta em blocos
+// pequenos: o arquivo e escrito sem uma copia inteira da malha em memoria.
+// Precisa do contexto GL e dos buffers ja desmapeados.
+bool storeCachedSphereMesh(const SphereMeshDesc& desc, const SphereMeshLayout& layout,
+					GLuint vertex_buffer, GLuint element_buffer,
+					const std::string& directory = "cache");
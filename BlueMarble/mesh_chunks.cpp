@@ -0,0 +1,224 @@
+#include "mesh_chunks.h"
+
+#include <cassert>
+#include <iostream>
+#include <unordered_map>
+
+namespace {
+
+std::uint64_t edgeKey(int from, int to) {
+	return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(from)) << 32) |
+		static_cast<std::uint32_t>(to);
+}
+
+}
+
+const char* indexFormatName(IndexFormat format) {
+	switch (format) {
+	case IndexFormat::Triangles32:
+		return "u32";
+	case IndexFormat::Triangles16:
+		return "u16";
+	case IndexFormat::Strips16:
+		return "strip";
+	}
+	return "?";
+}
+
+bool parseIndexFormat(const std::string& name, IndexFormat& format) {
+	for (IndexFormat candidate : { IndexFormat::Triangles32,
+								   IndexFormat::Triangles16,
+								   IndexFormat::Strips16 }) {
+		if (name == indexFormatName(candidate)) {
+			format = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+void stripifyTriangles(const std::vector<glm::ivec3>& triangles,
+					size_t vertex_count,
+					std::vector<std::uint16_t>& strip_indices) {
+	assert(vertex_count <= max_chunk_vertices);
+
+	// Aresta orientada -> triangulos que a contem nessa orientacao.
+	std::unordered_multimap<std::uint64_t, int> directed_edges;
+	directed_edges.reserve(triangles.size() * 3);
+	for (size_t t = 0; t < triangles.size(); t++) {
+		const glm::ivec3& triangle = triangles[t];
+		for (int corner = 0; corner < 3; corner++) {
+			directed_edges.emplace(
+				edgeKey(triangle[corner], triangle[(corner + 1) % 3]),
+				static_cast<int>(t));
+		}
+	}
+
+	std::vector<bool> emitted(triangles.size(), false);
+	std::vector<int> strip;
+
+	auto takeTriangle = [&](int from, int to) -> int {
+		auto range = directed_edges.equal_range(edgeKey(from, to));
+		for (auto it = range.first; it != range.second; ++it) {
+			if (!emitted[it->second]) {
+				return it->second;
+			}
+		}
+		return -1;
+	};
+
+	auto thirdVertex = [&](int t, int a, int b) {
+		const glm::ivec3& triangle = triangles[t];
+		for (int corner = 0; corner < 3; corner++) {
+			if (triangle[corner] != a && triangle[corner] != b) {
+				return triangle[corner];
+			}
+		}
+		return triangle.x;
+	};
+
+	strip_indices.clear();
+	strip_indices.reserve(triangles.size() * 2);
+
+	for (size_t start = 0; start < triangles.size(); start++) {
+		if (emitted[start]) {
+			continue;
+		}
+
+		// Comeca pela rotacao cuja ultima aresta tem um vizinho livre.
+		const glm::ivec3& first = triangles[start];
+		emitted[start] = true;
+
+		int rotation = 0;
+		for (int candidate = 0; candidate < 3; candidate++) {
+			const int b = first[(candidate + 1) % 3];
+			const int c = first[(candidate + 2) % 3];
+			if (takeTriangle(c, b) >= 0) {
+				rotation = candidate;
+				break;
+			}
+		}
+
+		strip.clear();
+		strip.push_back(first[rotation]);
+		strip.push_back(first[(rotation + 1) % 3]);
+		strip.push_back(first[(rotation + 2) % 3]);
+
+		// O triangulo i da strip e (v[i], v[i+1], v[i+2]) para i par e
+		// (v[i+1], v[i], v[i+2]) para i impar; o proximo precisa conter a
+		// aresta final na orientacao correspondente.
+		for (;;) {
+			const size_t next = strip.size() - 2;
+			const int x = strip[strip.size() - 2];
+			const int y = strip[strip.size() - 1];
+
+			const int t = (next % 2 == 0) ? takeTriangle(x, y) : takeTriangle(y, x);
+			if (t < 0) {
+				break;
+			}
+
+			emitted[t] = true;
+			strip.push_back(thirdVertex(t, x, y));
+		}
+
+		if (!strip_indices.empty()) {
+			strip_indices.push_back(primitive_restart_index);
+		}
+		for (int index : strip) {
+			strip_indices.push_back(static_cast<std::uint16_t>(index));
+		}
+	}
+}
+
+void buildChunkedMesh(size_t vertex_count,
+					const std::vector<glm::ivec3>& triangles,
+					bool strips,
+					ChunkedMesh& output,
+					bool reports) {
+	output.vertex_remap.clear();
+	output.indices.clear();
+	output.chunks.clear();
+	output.primitive = strips ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+
+	output.vertex_remap.reserve(vertex_count);
+	output.indices.reserve(strips ? triangles.size() * 2 : triangles.size() * 3);
+
+	// chunk_stamp[v] == numero do bloco atual quando local_index[v] e valido.
+	std::vector<int> chunk_stamp(vertex_count, -1);
+	std::vector<std::uint16_t> local_index(vertex_count, 0);
+
+	std::vector<glm::ivec3> chunk_triangles;
+	std::vector<std::uint16_t> strip_indices;
+	size_t chunk_begin_vertex = 0;
+
+	auto flushChunk = [&]() {
+		if (chunk_triangles.empty()) {
+			return;
+		}
+
+		MeshChunk chunk;
+		chunk.base_vertex = static_cast<GLint>(chunk_begin_vertex);
+		chunk.index_offset = output.indices.size() * sizeof(std::uint16_t);
+
+		if (strips) {
+			stripifyTriangles(chunk_triangles,
+				output.vertex_remap.size() - chunk_begin_vertex, strip_indices);
+			output.indices.insert(output.indices.end(),
+				strip_indices.begin(), strip_indices.end());
+			chunk.index_count = static_cast<GLsizei>(strip_indices.size());
+		} else {
+			for (const glm::ivec3& triangle : chunk_triangles) {
+				output.indices.push_back(static_cast<std::uint16_t>(triangle.x));
+				output.indices.push_back(static_cast<std::uint16_t>(triangle.y));
+				output.indices.push_back(static_cast<std::uint16_t>(triangle.z));
+			}
+			chunk.index_count = static_cast<GLsizei>(chunk_triangles.size() * 3);
+		}
+
+		output.chunks.push_back(chunk);
+		chunk_triangles.clear();
+		chunk_begin_vertex = output.vertex_remap.size();
+	};
+
+	for (const glm::ivec3& triangle : triangles) {
+		const int chunk_number = static_cast<int>(output.chunks.size());
+
+		size_t new_vertices = 0;
+		for (int corner = 0; corner < 3; corner++) {
+			if (chunk_stamp[triangle[corner]] != chunk_number) {
+				new_vertices++;
+			}
+		}
+
+		const size_t chunk_vertices = output.vertex_remap.size() - chunk_begin_vertex;
+		if (chunk_vertices + new_vertices > max_chunk_vertices) {
+			flushChunk();
+		}
+
+		const int current_chunk = static_cast<int>(output.chunks.size());
+		glm::ivec3 local;
+		for (int corner = 0; corner < 3; corner++) {
+			const int index = triangle[corner];
+			if (chunk_stamp[index] != current_chunk) {
+				chunk_stamp[index] = current_chunk;
+				local_index[index] = static_cast<std::uint16_t>(
+					output.vertex_remap.size() - chunk_begin_vertex);
+				output.vertex_remap.push_back(static_cast<GLuint>(index));
+			}
+			local[corner] = local_index[index];
+		}
+		chunk_triangles.push_back(local);
+	}
+
+	flushChunk();
+
+	if (!reports) {
+		return;
+	}
+
+	std::cout << "Blocos de indices 16 bits - " << output.chunks.size()
+		<< " blocos, " << output.vertex_remap.size() << " vertices ("
+		<< output.vertex_remap.size() - vertex_count << " duplicados), "
+		<< output.indices.size() << " indices"
+		<< (strips ? " em strips" : "") << std::endl;
+}
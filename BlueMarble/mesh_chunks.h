@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "sphere_mesh.h"
+
+enum class IndexFormat {
+	// Um unico buffer de indices de 32 bits com triangulos independentes.
+	Triangles32,
+	// Blocos com menos de 65536 vertices e indices de 16 bits.
+	Triangles16,
+	// Blocos de 16 bits desenhados como triangle strips com primitive restart.
+	Strips16
+};
+
+// Indice reservado para reiniciar as strips; nenhum bloco usa este vertice.
+constexpr std::uint16_t primitive_restart_index = 0xFFFF;
+constexpr size_t max_chunk_vertices = primitive_restart_index;
+
+struct MeshChunk {
+	GLint base_vertex = 0;
+	GLsizei index_count = 0;
+	// Deslocamento em bytes no element buffer.
+	size_t index_offset = 0;
+};
+
+// Os vertices nao sao copiados: vertex_remap diz qual vertice da entrada
+// ocupa cada posicao da saida (os duplicados aparecem mais de uma vez) e o
+// pipeline os codifica direto no destino final.
+struct ChunkedMesh {
+	std::vector<GLuint> vertex_remap;
+	std::vector<std::uint16_t> indices;
+	std::vector<MeshChunk> chunks;
+	GLenum primitive = GL_TRIANGLES;
+};
+
+const char* indexFormatName(IndexFormat format);
+bool parseIndexFormat(const std::string& name, IndexFormat& format);
+
+// Divide a malha em blocos de ate max_chunk_vertices vertices, seguindo a
+// ordem dos triangulos (a ordem do otimizador mantem os blocos compactos).
+// Vertices compartilhados entre blocos sao duplicados.
+void buildChunkedMesh(size_t vertex_count,
+					const std::vector<glm::ivec3>& triangles,
+					bool strips,
+					ChunkedMesh& output,
+					bool reports = true);
+
+// Converte uma lista de triangulos em strips separadas por
+// primitive_restart_index, preservando a orientacao de cada triangulo.
+void stripifyTriangles(const std::vector<glm::ivec3>& triangles,
+					size_t vertex_count,
+					std::vector<std::uint16_t>& strip_indices);
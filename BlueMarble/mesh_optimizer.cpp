@@ -0,0 +1,271 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+
+VertexCacheStats analyzeVertexCache(const std::vector<glm::ivec3>& indices,
+					size_t vertex_count, size_t cache_size) {
+	VertexCacheStats stats;
+	if (indices.empty() || vertex_count == 0) {
+		return stats;
+	}
+
+	// timestamp[v] guarda o instante em que v entrou no cache; o vertice
+	// ainda esta no cache FIFO enquanto misses - timestamp < cache_size.
+	std::vector<size_t> timestamp(vertex_count, 0);
+	size_t misses = 0;
+
+	for (const glm::ivec3& triangle : indices) {
+		for (int corner = 0; corner < 3; corner++) {
+			const int index = triangle[corner];
+			if (timestamp[index] == 0 || misses - timestamp[index] >= cache_size) {
+				misses++;
+				timestamp[index] = misses;
+			}
+		}
+	}
+
+	stats.acmr = static_cast<float>(misses) / indices.size();
+	stats.atvr = static_cast<float>(misses) / vertex_count;
+	return stats;
+}
+
+void optimizeVertexCache(std::vector<glm::ivec3>& indices, size_t vertex_count,
+					size_t cache_size, std::vector<size_t>* clusters) {
+	const size_t triangle_count = indices.size();
+	if (triangle_count == 0) {
+		return;
+	}
+
+	// Lista de adjacencia vertice -> triangulos em formato CSR.
+	std::vector<int> live_triangles(vertex_count, 0);
+	for (const glm::ivec3& triangle : indices) {
+		live_triangles[triangle.x]++;
+		live_triangles[triangle.y]++;
+		live_triangles[triangle.z]++;
+	}
+
+	std::vector<size_t> adjacency_offset(vertex_count + 1, 0);
+	std::partial_sum(live_triangles.begin(), live_triangles.end(),
+		adjacency_offset.begin() + 1);
+
+	std::vector<int> adjacency(adjacency_offset.back());
+	std::vector<size_t> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+	for (size_t t = 0; t < triangle_count; t++) {
+		for (int corner = 0; corner < 3; corner++) {
+			adjacency[fill[indices[t][corner]]++] = static_cast<int>(t);
+		}
+	}
+
+	std::vector<size_t> cache_time(vertex_count, 0);
+	std::vector<bool> emitted(triangle_count, false);
+	std::vector<int> dead_end;
+	std::vector<int> candidates;
+
+	std::vector<glm::ivec3> output;
+	output.reserve(triangle_count);
+
+	if (clusters) {
+		clusters->clear();
+		clusters->push_back(0);
+	}
+
+	size_t time_stamp = cache_size + 1;
+	size_t cursor = 0;
+	int fanning = indices[0].x;
+
+	while (fanning >= 0) {
+		candidates.clear();
+
+		for (size_t a = adjacency_offset[fanning]; a < adjacency_offset[fanning + 1]; a++) {
+			const int t = adjacency[a];
+			if (emitted[t]) {
+				continue;
+			}
+
+			const glm::ivec3& triangle = indices[t];
+			for (int corner = 0; corner < 3; corner++) {
+				const int v = triangle[corner];
+				dead_end.push_back(v);
+				candidates.push_back(v);
+				live_triangles[v]--;
+				if (time_stamp - cache_time[v] > cache_size) {
+					cache_time[v] = time_stamp++;
+				}
+			}
+
+			emitted[t] = true;
+			output.push_back(triangle);
+		}
+
+		// Proximo vertice em leque: o candidato que continua no cache apos
+		// emitir seus triangulos restantes e que esta ha mais tempo nele.
+		int next = -1;
+		long best_priority = -1;
+		for (int v : candidates) {
+			if (live_triangles[v] <= 0) {
+				continue;
+			}
+
+			long priority = 0;
+			if (time_stamp - cache_time[v] + 2 * live_triangles[v] <= cache_size) {
+				priority = static_cast<long>(time_stamp - cache_time[v]);
+			}
+			if (priority > best_priority) {
+				best_priority = priority;
+				next = v;
+			}
+		}
+
+		// Dead-end: nenhum candidato serve e o leque recomeca pela pilha ou,
+		// se ela acabou, pelo cursor. Os dois casos abrem um grupo novo.
+		const bool restarted = next == -1;
+
+		if (next == -1) {
+			while (!dead_end.empty()) {
+				const int v = dead_end.back();
+				dead_end.pop_back();
+				if (live_triangles[v] > 0) {
+					next = v;
+					break;
+				}
+			}
+		}
+
+		if (next == -1) {
+			while (cursor < vertex_count) {
+				if (live_triangles[cursor] > 0) {
+					next = static_cast<int>(cursor);
+					break;
+				}
+				cursor++;
+			}
+		}
+
+		if (clusters && restarted && next != -1 && output.size() > clusters->back()) {
+			clusters->push_back(output.size());
+		}
+
+		fanning = next;
+	}
+
+	assert(output.size() == triangle_count);
+	indices.swap(output);
+}
+
+void optimizeOverdraw(std::vector<glm::ivec3>& indices,
+					const std::vector<vertex>& vertices,
+					const std::vector<size_t>& clusters) {
+	if (clusters.size() < 2) {
+		return;
+	}
+
+	glm::vec3 mesh_centroid{ 0.0f };
+	for (const vertex& v : vertices) {
+		mesh_centroid += v.position;
+	}
+	mesh_centroid /= static_cast<float>(vertices.size());
+
+	const size_t cluster_count = clusters.size();
+	std::vector<float> sort_key(cluster_count);
+
+	for (size_t cluster = 0; cluster < cluster_count; cluster++) {
+		const size_t begin = clusters[cluster];
+		const size_t end = cluster + 1 < cluster_count ? clusters[cluster + 1] : indices.size();
+
+		glm::vec3 centroid{ 0.0f };
+		glm::vec3 normal{ 0.0f };
+		float area = 0.0f;
+
+		for (size_t t = begin; t < end; t++) {
+			const glm::vec3& p0 = vertices[indices[t].x].position;
+			const glm::vec3& p1 = vertices[indices[t].y].position;
+			const glm::vec3& p2 = vertices[indices[t].z].position;
+
+			const glm::vec3 triangle_normal = glm::cross(p1 - p0, p2 - p0);
+			const float triangle_area = glm::length(triangle_normal);
+
+			centroid += (p0 + p1 + p2) * (triangle_area / 3.0f);
+			normal += triangle_normal;
+			area += triangle_area;
+		}
+
+		if (area > 0.0f) {
+			centroid /= area;
+		}
+
+		const float normal_length = glm::length(normal);
+		if (normal_length > 0.0f) {
+			normal /= normal_length;
+		}
+
+		sort_key[cluster] = glm::dot(centroid - mesh_centroid, normal);
+	}
+
+	std::vector<size_t> order(cluster_count);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+		return sort_key[a] > sort_key[b];
+	});
+
+	std::vector<glm::ivec3> output;
+	output.reserve(indices.size());
+	for (size_t cluster : order) {
+		const size_t begin = clusters[cluster];
+		const size_t end = cluster + 1 < cluster_count ? clusters[cluster + 1] : indices.size();
+		output.insert(output.end(), indices.begin() + begin, indices.begin() + end);
+	}
+
+	indices.swap(output);
+}
+
+void optimizeVertexFetch(std::vector<vertex>& vertices,
+					std::vector<glm::ivec3>& indices) {
+	std::vector<int> remap(vertices.size(), -1);
+	std::vector<vertex> output;
+	output.reserve(vertices.size());
+
+	for (glm::ivec3& triangle : indices) {
+		for (int corner = 0; corner < 3; corner++) {
+			int& index = triangle[corner];
+			if (remap[index] == -1) {
+				remap[index] = static_cast<int>(output.size());
+				output.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+	}
+
+	// Vertices sem referencia sao descartados.
+	vertices.swap(output);
+}
+
+void optimizeMesh(std::vector<vertex>& vertices,
+					std::vector<glm::ivec3>& indices,
+					bool reports) {
+	const auto start_time = std::chrono::steady_clock::now();
+
+	const VertexCacheStats before = analyzeVertexCache(indices, vertices.size());
+
+	std::vector<size_t> clusters;
+	optimizeVertexCache(indices, vertices.size(), 16, &clusters);
+	optimizeOverdraw(indices, vertices, clusters);
+	optimizeVertexFetch(vertices, indices);
+
+	const VertexCacheStats after = analyzeVertexCache(indices, vertices.size());
+
+	const std::chrono::duration<double, std::milli> elapsed =
+		std::chrono::steady_clock::now() - start_time;
+
+	if (!reports) {
+		return;
+	}
+
+	std::cout << "Otimizacao de indices - " << clusters.size() << " grupos em "
+		<< elapsed.count() << " ms" << std::endl
+		<< "  ACMR " << before.acmr << " -> " << after.acmr << std::endl
+		<< "  ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+}
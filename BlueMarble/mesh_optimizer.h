@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "sphere_mesh.h"
+
+struct VertexCacheStats {
+	// Vertices transformados por triangulo (ideal ~0.5, pior caso 3.0).
+	float acmr = 0.0f;
+	// Vertices transformados por vertice da malha (ideal 1.0).
+	float atvr = 0.0f;
+};
+
+// Simula um cache FIFO de vertices transformados com cache_size entradas.
+VertexCacheStats analyzeVertexCache(const std::vector<glm::ivec3>& indices,
+					size_t vertex_count, size_t cache_size = 16);
+
+// Reordena os triangulos com o algoritmo Tipsify (Sander, Nehab e Barczak,
+// 2007). Se clusters != nullptr, recebe o primeiro triangulo de cada grupo
+// emitido apos um dead-end, usado por optimizeOverdraw.
+void optimizeVertexCache(std::vector<glm::ivec3>& indices, size_t vertex_count,
+					size_t cache_size = 16,
+					std::vector<size_t>* clusters = nullptr);
+
+// Ordena os grupos de triangulos de fora para dentro (metrica de oclusao
+// independente de camera do Tipsify) preservando a ordem dentro de cada grupo.
+void optimizeOverdraw(std::vector<glm::ivec3>& indices,
+					const std::vector<vertex>& vertices,
+					const std::vector<size_t>& clusters);
+
+// Reordena o vertex buffer pela ordem de primeiro uso nos indices.
+void optimizeVertexFetch(std::vector<vertex>& vertices,
+					std::vector<glm::ivec3>& indices);
+
+// Executa as tres etapas acima; com reports imprime ACMR/ATVR antes e depois.
+void optimizeMesh(std::vector<vertex>& vertices,
+					std::vector<glm::ivec3>& indices,
+					bool reports = true);
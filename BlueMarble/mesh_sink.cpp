@@ -0,0 +1,73 @@
+#include "mesh_sink.h"
+
+#include <cassert>
+#include <iostream>
+
+namespace {
+
+// Os buffers sao criados e mapeados em GL_COPY_WRITE_BUFFER para nao mexer
+// no GL_ELEMENT_ARRAY_BUFFER do VAO que estiver ligado.
+void* mapNewBuffer(GLuint& buffer, size_t bytes) {
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+
+	if (GLEW_ARB_buffer_storage) {
+		glBufferStorage(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_MAP_WRITE_BIT);
+	} else {
+		glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+	}
+
+	void* mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, bytes,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+	if (!mapped) {
+		std::cout << "Erro ao mapear buffer de malha - " << bytes << " bytes" << std::endl;
+		assert(false);
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return mapped;
+}
+
+void unmapBuffer(GLuint buffer) {
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+
+	if (glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_FALSE) {
+		// Conteudo perdido (ex.: troca de modo de video durante o mapeamento).
+		std::cout << "Buffer de malha corrompido ao desmapear" << std::endl;
+		assert(false);
+	}
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+}
+
+void* MemoryMeshSink::vertices(size_t bytes) {
+	vertex_data.resize(bytes);
+	return vertex_data.data();
+}
+
+void* MemoryMeshSink::indices(size_t bytes) {
+	index_data.resize(bytes);
+	return index_data.data();
+}
+
+void* BufferMeshSink::vertices(size_t bytes) {
+	assert(vertex_buffer == 0);
+	return mapNewBuffer(vertex_buffer, bytes);
+}
+
+void* BufferMeshSink::indices(size_t bytes) {
+	assert(element_buffer == 0);
+	return mapNewBuffer(element_buffer, bytes);
+}
+
+void BufferMeshSink::finish() {
+	if (vertex_buffer != 0) {
+		unmapBuffer(vertex_buffer);
+	}
+	if (element_buffer != 0) {
+		unmapBuffer(element_buffer);
+	}
+}
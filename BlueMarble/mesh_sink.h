@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <GL/glew.h>
+
+// Destino dos bytes de uma malha. O pipeline pede o espaco de vertices e de
+// indices uma vez cada e escreve direto na memoria retornada (de qualquer
+// thread); finish() e chamado na thread do GL quando tudo foi escrito.
+class MeshSink {
+public:
+	virtual ~MeshSink() = default;
+
+	virtual void* vertices(size_t bytes) = 0;
+	virtual void* indices(size_t bytes) = 0;
+	virtual void finish() {}
+};
+
+// Guarda a malha em memoria comum (cache em disco, testes).
+class MemoryMeshSink : public MeshSink {
+public:
+	void* vertices(size_t bytes) override;
+	void* indices(size_t bytes) override;
+
+	std::vector<unsigned char> vertex_data;
+	std::vector<unsigned char> index_data;
+};
+
+// Escreve direto em buffers GL mapeados com glMapBufferRange. Com
+// ARB_buffer_storage os buffers sao imutaveis (glBufferStorage); sem ele sao
+// alocados com glBufferData(nullptr). Precisa de um contexto GL corrente.
+class BufferMeshSink : public MeshSink {
+public:
+	BufferMeshSink() = default;
+
+	BufferMeshSink(const BufferMeshSink&) = delete;
+	BufferMeshSink& operator=(const BufferMeshSink&) = delete;
+
+	void* vertices(size_t bytes) override;
+	void* indices(size_t bytes) override;
+	void finish() override;
+
+	GLuint vertexBuffer() const { return vertex_buffer; }
+	GLuint elementBuffer() const { return element_buffer; }
+
+private:
+	GLuint vertex_buffer = 0;
+	GLuint element_buffer = 0;
+};
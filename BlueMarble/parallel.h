@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+inline unsigned int workerCount() {
+	const unsigned int hardware_threads = std::thread::hardware_concurrency();
+	return hardware_threads > 0 ? hardware_threads : 1;
+}
+
+// Divide [begin, end) em faixas contiguas e chama function(inicio, fim) para
+// cada faixa em uma thread. A ultima faixa roda na thread que chamou.
+template <typename Function>
+void parallelFor(size_t begin, size_t end, Function&& function, size_t min_grain = 1) {
+	if (end <= begin) {
+		return;
+	}
+
+	const size_t count = end - begin;
+	const size_t max_ranges = std::max<size_t>(1, count / std::max<size_t>(1, min_grain));
+	const size_t num_ranges = std::min<size_t>(workerCount(), max_ranges);
+
+	if (num_ranges == 1) {
+		function(begin, end);
+		return;
+	}
+
+	const size_t range_size = (count + num_ranges - 1) / num_ranges;
+
+	std::vector<std::thread> threads;
+	threads.reserve(num_ranges - 1);
+
+	size_t range_begin = begin;
+	while (range_begin + range_size < end) {
+		const size_t range_end = range_begin + range_size;
+		threads.emplace_back([&function, range_begin, range_end]() {
+			function(range_begin, range_end);
+		});
+		range_begin = range_end;
+	}
+
+	function(range_begin, end);
+
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
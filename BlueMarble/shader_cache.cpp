@@ -0,0 +1,170 @@
+#include "shader_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "hash.h"
+#include "mapped_file.h"
+
+namespace {
+
+constexpr char program_cache_magic[8] = { 'B', 'M', 'P', 'R', 'O', 'G', '\0', '\0' };
+constexpr std::uint32_t program_cache_file_version = 1;
+
+struct programCacheHeader {
+	char magic[8];
+	std::uint32_t file_version;
+	std::uint32_t binary_format;
+	std::uint64_t key;
+	std::uint64_t binary_bytes;
+};
+
+// Cada parte entra com o tamanho na frente para "ab" + "c" nao colidir com
+// "a" + "bc".
+std::uint64_t hashString(const std::string& text, std::uint64_t hash) {
+	const std::uint64_t size = text.size();
+	hash = fnv1a(&size, sizeof(size), hash);
+	return fnv1a(text.data(), text.size(), hash);
+}
+
+std::uint64_t hashGLString(GLenum name, std::uint64_t hash) {
+	const GLubyte* value = glGetString(name);
+	return hashString(value ? reinterpret_cast<const char*>(value) : "", hash);
+}
+
+}
+
+bool programBinarySupported() {
+	if (!GLEW_ARB_get_program_binary) {
+		return false;
+	}
+
+	GLint num_formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+	return num_formats > 0;
+}
+
+std::uint64_t programCacheKey(const std::string& vertex_source,
+					const std::string& fragment_source,
+					const std::string& defines) {
+	std::uint64_t hash = fnv1a_offset_basis;
+	hash = hashGLString(GL_VENDOR, hash);
+	hash = hashGLString(GL_RENDERER, hash);
+	hash = hashGLString(GL_VERSION, hash);
+	hash = hashString(defines, hash);
+	hash = hashString(vertex_source, hash);
+	hash = hashString(fragment_source, hash);
+	return hash;
+}
+
+std::string programCachePath(std::uint64_t key, const std::string& directory) {
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx",
+		static_cast<unsigned long long>(key));
+	return directory + "/program_" + name + ".bin";
+}
+
+GLuint loadCachedProgram(std::uint64_t key, const std::string& directory) {
+	if (!programBinarySupported()) {
+		return 0;
+	}
+
+	const std::string path = programCachePath(key, directory);
+
+	MappedFile file;
+	if (!file.open(path)) {
+		return 0;
+	}
+
+	programCacheHeader header;
+	bool valid = file.size() >= sizeof(header);
+	if (valid) {
+		std::memcpy(&header, file.data(), sizeof(header));
+
+		valid = std::memcmp(header.magic, program_cache_magic, sizeof(header.magic)) == 0 &&
+			header.file_version == program_cache_file_version &&
+			header.key == key &&
+			header.binary_bytes > 0 &&
+			sizeof(header) + header.binary_bytes <= file.size();
+	}
+
+	if (!valid) {
+		std::cout << "Cache de programa invalido - " << path << std::endl;
+		return 0;
+	}
+
+	GLuint program_id = glCreateProgram();
+	glProgramBinary(program_id, header.binary_format, file.data() + sizeof(header),
+		static_cast<GLsizei>(header.binary_bytes));
+
+	// O driver pode recusar binarios de outra versao mesmo com a chave igual;
+	// nesse caso o chamador compila dos fontes e regrava o arquivo.
+	GLint result = GL_FALSE;
+	glGetProgramiv(program_id, GL_LINK_STATUS, &result);
+
+	if (result == GL_FALSE) {
+		std::cout << "Binario de programa recusado pelo driver - " << path << std::endl;
+		glDeleteProgram(program_id);
+		return 0;
+	}
+
+	std::cout << "Programa carregado do cache - " << path << std::endl;
+	return program_id;
+}
+
+bool storeCachedProgram(std::uint64_t key, GLuint program_id,
+					const std::string& directory) {
+	if (!programBinarySupported()) {
+		return false;
+	}
+
+	GLint binary_length = 0;
+	glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+	if (binary_length <= 0) {
+		return false;
+	}
+
+	std::vector<char> binary(static_cast<size_t>(binary_length));
+	GLsizei written = 0;
+	GLenum binary_format = 0;
+	glGetProgramBinary(program_id, binary_length, &written, &binary_format, binary.data());
+	if (written <= 0) {
+		return false;
+	}
+
+	programCacheHeader header{};
+	std::memcpy(header.magic, program_cache_magic, sizeof(header.magic));
+	header.file_version = program_cache_file_version;
+	header.binary_format = binary_format;
+	header.key = key;
+	header.binary_bytes = static_cast<std::uint64_t>(written);
+
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+
+	const std::string path = programCachePath(key, directory);
+	const std::string temporary_path = path + ".tmp";
+
+	{
+		std::ofstream stream{ temporary_path, std::ios::binary | std::ios::trunc };
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(binary.data(), written);
+
+		if (!stream) {
+			std::cout << "Erro ao gravar cache de programa - " << path << std::endl;
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temporary_path, path, error);
+	if (error) {
+		std::filesystem::remove(path, error);
+		std::filesystem::rename(temporary_path, path, error);
+	}
+
+	return !error;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <GL/glew.h>
+
+// Cache em disco de programas ja linkados (glGetProgramBinary). A chave e um
+// hash dos fontes, dos defines e de fabricante/renderizador/versao do driver,
+// entao trocar de placa ou atualizar o driver gera outro arquivo em vez de
+// reaproveitar um binario incompativel. Precisa de um contexto GL corrente.
+
+bool programBinarySupported();
+
+std::uint64_t programCacheKey(const std::string& vertex_source,
+					const std::string& fragment_source,
+					const std::string& defines);
+
+std::string programCachePath(std::uint64_t key,
+					const std::string& directory = "cache");
+
+// Cria um programa a partir do binario em cache. Retorna 0 se nao existir,
+// estiver corrompido ou se o driver recusar o binario.
+GLuint loadCachedProgram(std::uint64_t key,
+					const std::string& directory = "cache");
+
+// O programa precisa ter sido linkado com GL_PROGRAM_BINARY_RETRIEVABLE_HINT.
+bool storeCachedProgram(std::uint64_t key, GLuint program_id,
+					const std::string& directory = "cache");
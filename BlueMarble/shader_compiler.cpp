@@ -0,0 +1,286 @@
+#include "shader_compiler.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+
+// #line com numeros (GLSL nao aceita nomes de arquivo).
+#define STB_INCLUDE_IMPLEMENTATION
+#define STB_INCLUDE_LINE_GLSL
+#include <stb_include.h>
+
+#include "shader_cache.h"
+
+namespace {
+
+GLuint compileShader(GLenum type, const std::string& source) {
+	GLuint shader_id = glCreateShader(type);
+	const char* source_pt = source.c_str();
+	glShaderSource(shader_id, 1, &source_pt, nullptr);
+	glCompileShader(shader_id);
+	return shader_id;
+}
+
+// So chamado depois do link terminar, quando a consulta nao bloqueia mais.
+bool checkShader(GLuint shader_id, const std::string& file) {
+	GLint result = GL_TRUE;
+	glGetShaderiv(shader_id, GL_COMPILE_STATUS, &result);
+
+	if (result == GL_FALSE) {
+		GLint info_log_length = 0;
+		glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &info_log_length);
+
+		std::cout << "Erro no shader - " << file << std::endl;
+
+		if (info_log_length > 0) {
+			std::string shader_info_log(info_log_length, '\0');
+			glGetShaderInfoLog(shader_id, info_log_length, nullptr, &shader_info_log[0]);
+			std::cout << shader_info_log << std::endl;
+		}
+	}
+
+	return result == GL_TRUE;
+}
+
+// Consulta o link (bloqueia se ainda nao terminou), mostra os erros e solta
+// os shaders do programa.
+bool checkProgram(GLuint program_id, GLuint vertex_shader_id, GLuint fragment_shader_id,
+				  const std::string& vertex_file, const std::string& fragment_file) {
+	GLint result = GL_TRUE;
+	glGetProgramiv(program_id, GL_LINK_STATUS, &result);
+
+	if (result == GL_FALSE) {
+		checkShader(vertex_shader_id, vertex_file);
+		checkShader(fragment_shader_id, fragment_file);
+
+		GLint info_log_length = 0;
+		glGetProgramiv(program_id, GL_INFO_LOG_LENGTH, &info_log_length);
+
+		std::cout << "Erro ao linkar programa - " << vertex_file << ", "
+			<< fragment_file << std::endl;
+
+		if (info_log_length > 0) {
+			std::string program_info_log(info_log_length, '\0');
+			glGetProgramInfoLog(program_id, info_log_length, nullptr, &program_info_log[0]);
+			std::cout << program_info_log << std::endl;
+		}
+	}
+
+	glDetachShader(program_id, vertex_shader_id);
+	glDetachShader(program_id, fragment_shader_id);
+
+	return result == GL_TRUE;
+}
+
+}
+
+std::string loadShaderSource(const std::string& file, const std::string& defines) {
+	// A API do stb_include recebe char* mutaveis.
+	std::string file_name = file;
+	std::string inject = defines;
+	std::string include_directory = std::filesystem::path(file).parent_path().string();
+	if (include_directory.empty()) {
+		include_directory = ".";
+	}
+
+	char error[256] = {};
+	char* expanded = stb_include_file(&file_name[0], &inject[0], &include_directory[0], error);
+	if (expanded == nullptr) {
+		std::cout << "Erro ao ler shader - " << file << " " << error << std::endl;
+		return std::string();
+	}
+
+	std::string source = expanded;
+	std::free(expanded);
+	return source;
+}
+
+GLuint buildProgram(const ProgramSource& source) {
+	const std::string& vertex_file = source.vertex_file;
+	const std::string& fragment_file = source.fragment_file;
+
+	const std::string vertex_source = loadShaderSource(vertex_file, source.defines);
+	const std::string fragment_source = loadShaderSource(fragment_file, source.defines);
+
+	if (vertex_source.empty() || fragment_source.empty()) {
+		return 0;
+	}
+
+	GLuint vertex_shader_id = compileShader(GL_VERTEX_SHADER, vertex_source);
+	GLuint fragment_shader_id = compileShader(GL_FRAGMENT_SHADER, fragment_source);
+
+	GLuint program_id = glCreateProgram();
+	glAttachShader(program_id, vertex_shader_id);
+	glAttachShader(program_id, fragment_shader_id);
+	glLinkProgram(program_id);
+
+	const bool linked = checkProgram(program_id, vertex_shader_id, fragment_shader_id,
+		vertex_file, fragment_file);
+
+	glDeleteShader(vertex_shader_id);
+	glDeleteShader(fragment_shader_id);
+
+	if (!linked) {
+		glDeleteProgram(program_id);
+		return 0;
+	}
+
+	return program_id;
+}
+
+void ShaderCompiler::initialize(bool use_cache, const ProgramBindings& bindings) {
+	this->use_cache = use_cache;
+	this->bindings = bindings;
+
+	parallel_compile = GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+	if (GLEW_KHR_parallel_shader_compile) {
+		// 0xFFFFFFFF deixa o driver escolher quantas threads usar.
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	} else if (GLEW_ARB_parallel_shader_compile) {
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+	}
+
+	std::cout << "Compilacao paralela de shaders - "
+		<< (parallel_compile ? "sim" : "nao") << std::endl;
+}
+
+ShaderCompiler::Handle ShaderCompiler::submit(const ProgramSource& source) {
+	compiledProgram entry;
+	entry.source = source;
+
+	const std::string vertex_source = loadShaderSource(source.vertex_file, source.defines);
+	const std::string fragment_source = loadShaderSource(source.fragment_file, source.defines);
+
+	if (vertex_source.empty() || fragment_source.empty()) {
+		entry.status = Status::Failed;
+		programs.push_back(entry);
+		return programs.size() - 1;
+	}
+
+	// Os fontes ja expandidos: mudar um include tambem muda a chave.
+	entry.cache_key = programCacheKey(vertex_source, fragment_source, source.defines);
+
+	if (use_cache) {
+		entry.program_id = loadCachedProgram(entry.cache_key);
+		if (entry.program_id != 0) {
+			entry.program = ShaderProgram(entry.program_id, bindings);
+			entry.status = Status::Ready;
+			programs.push_back(entry);
+			return programs.size() - 1;
+		}
+	}
+
+	entry.vertex_shader_id = compileShader(GL_VERTEX_SHADER, vertex_source);
+	entry.fragment_shader_id = compileShader(GL_FRAGMENT_SHADER, fragment_source);
+
+	entry.program_id = glCreateProgram();
+	glAttachShader(entry.program_id, entry.vertex_shader_id);
+	glAttachShader(entry.program_id, entry.fragment_shader_id);
+	if (use_cache && programBinarySupported()) {
+		glProgramParameteri(entry.program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(entry.program_id);
+
+	programs.push_back(entry);
+	return programs.size() - 1;
+}
+
+bool ShaderCompiler::isComplete(const compiledProgram& entry) const {
+	if (!parallel_compile) {
+		return true;
+	}
+
+	GLint complete = GL_FALSE;
+	glGetProgramiv(entry.program_id, GL_COMPLETION_STATUS_KHR, &complete);
+	return complete == GL_TRUE;
+}
+
+void ShaderCompiler::finish(compiledProgram& entry) {
+	const bool linked = checkProgram(entry.program_id,
+		entry.vertex_shader_id, entry.fragment_shader_id,
+		entry.source.vertex_file, entry.source.fragment_file);
+
+	glDeleteShader(entry.vertex_shader_id);
+	glDeleteShader(entry.fragment_shader_id);
+	entry.vertex_shader_id = 0;
+	entry.fragment_shader_id = 0;
+
+	if (!linked) {
+		glDeleteProgram(entry.program_id);
+		entry.program_id = 0;
+		entry.program = ShaderProgram();
+		entry.status = Status::Failed;
+		return;
+	}
+
+	if (use_cache) {
+		storeCachedProgram(entry.cache_key, entry.program_id);
+	}
+
+	entry.program = ShaderProgram(entry.program_id, bindings);
+	entry.status = Status::Ready;
+}
+
+void ShaderCompiler::update() {
+	for (compiledProgram& entry : programs) {
+		if (entry.status != Status::Compiling || !isComplete(entry)) {
+			continue;
+		}
+
+		finish(entry);
+
+		// Sem a extensao a consulta do link bloqueia; um por quadro.
+		if (!parallel_compile) {
+			break;
+		}
+	}
+}
+
+void ShaderCompiler::replace(Handle handle, GLuint program_id) {
+	assert(handle < programs.size());
+	compiledProgram& entry = programs[handle];
+
+	if (entry.vertex_shader_id != 0) {
+		glDeleteShader(entry.vertex_shader_id);
+		glDeleteShader(entry.fragment_shader_id);
+		entry.vertex_shader_id = 0;
+		entry.fragment_shader_id = 0;
+	}
+	if (entry.program_id != 0) {
+		glDeleteProgram(entry.program_id);
+	}
+
+	entry.program_id = program_id;
+	entry.program = ShaderProgram(program_id, bindings);
+	entry.status = Status::Ready;
+}
+
+const ShaderProgram* ShaderCompiler::program(Handle handle) const {
+	assert(handle < programs.size());
+	const compiledProgram& entry = programs[handle];
+	return entry.status == Status::Ready ? &entry.program : nullptr;
+}
+
+size_t ShaderCompiler::pending() const {
+	size_t count = 0;
+	for (const compiledProgram& entry : programs) {
+		count += entry.status == Status::Compiling;
+	}
+	return count;
+}
+
+void ShaderCompiler::release() {
+	for (compiledProgram& entry : programs) {
+		if (entry.vertex_shader_id != 0) {
+			glDeleteShader(entry.vertex_shader_id);
+		}
+		if (entry.fragment_shader_id != 0) {
+			glDeleteShader(entry.fragment_shader_id);
+		}
+		if (entry.program_id != 0) {
+			glDeleteProgram(entry.program_id);
+		}
+	}
+	programs.clear();
+}
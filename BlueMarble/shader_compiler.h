@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+
+#include <GL/glew.h>
+
+#include "shader_program.h"
+
+// Fontes de um programa. defines entra no lugar da linha "#inject" dos dois
+// arquivos (logo apos #version) e linhas #include "arquivo" sao expandidas a
+// partir da pasta de cada arquivo (stb_include.h).
+struct ProgramSource {
+	std::string vertex_file;
+	std::string fragment_file;
+	std::string defines;
+};
+
+// Compila programas sem travar o render loop. submit() le os fontes, tenta o
+// cache de binarios (shader_cache.h) e, se nao houver, dispara compilacao e
+// link sem consultar GL_COMPILE_STATUS/GL_LINK_STATUS, o que forcaria o
+// driver a terminar ali. Todos os programas podem ser enviados de uma vez.
+//
+// update(), chamado uma vez por quadro na thread do GL, consulta
+// GL_COMPLETION_STATUS_KHR (KHR_parallel_shader_compile) e so finaliza os
+// programas que o driver ja terminou nas threads dele. Sem a extensao,
+// finaliza um programa por quadro. Ate ficar pronto, program() devolve
+// nullptr e o chamador pula o desenho ou usa outro programa.
+//
+// Todo programa pronto (compilado, vindo do cache ou recarregado) e refletido
+// em um ShaderProgram e recebe os ProgramBindings de initialize().
+class ShaderCompiler {
+public:
+	using Handle = size_t;
+
+	enum class Status {
+		Compiling,
+		Ready,
+		Failed
+	};
+
+	ShaderCompiler() = default;
+
+	ShaderCompiler(const ShaderCompiler&) = delete;
+	ShaderCompiler& operator=(const ShaderCompiler&) = delete;
+
+	void initialize(bool use_cache, const ProgramBindings& bindings);
+
+	Handle submit(const ProgramSource& source);
+
+	void update();
+
+	// Troca o programa de handle por um ja linkado (recarga de shaders); o
+	// anterior e apagado.
+	void replace(Handle handle, GLuint program_id);
+
+	Status status(Handle handle) const { return programs[handle].status; }
+	const ProgramSource& source(Handle handle) const { return programs[handle].source; }
+	// Handles vao de 0 a size() - 1, na ordem de submit().
+	size_t size() const { return programs.size(); }
+	// nullptr enquanto compila ou se falhou. O ponteiro continua valido
+	// depois de outros submit(); replace() troca o conteudo.
+	const ShaderProgram* program(Handle handle) const;
+	size_t pending() const;
+
+	void release();
+
+private:
+	struct compiledProgram {
+		ProgramSource source;
+		std::uint64_t cache_key = 0;
+		GLuint vertex_shader_id = 0;
+		GLuint fragment_shader_id = 0;
+		GLuint program_id = 0;
+		ShaderProgram program;
+		Status status = Status::Compiling;
+	};
+
+	bool isComplete(const compiledProgram& entry) const;
+	void finish(compiledProgram& entry);
+
+	std::deque<compiledProgram> programs;
+	ProgramBindings bindings;
+	bool parallel_compile = false;
+	bool use_cache = true;
+};
+
+// Compila e linka esperando o resultado, na thread e contexto atuais. Mostra
+// os erros e devolve 0 se falhar.
+GLuint buildProgram(const ProgramSource& source);
+
+// Texto de um estagio com defines injetados e includes expandidos; vazio (e
+// erro mostrado) se o arquivo ou algum include faltar.
+std::string loadShaderSource(const std::string& file, const std::string& defines);
@@ -0,0 +1,74 @@
+#include "shader_program.h"
+
+#include <algorithm>
+
+ShaderProgram::ShaderProgram(GLuint program_id, const ProgramBindings& bindings)
+	: program_id(program_id) {
+	reflect();
+
+	for (const auto& block : bindings.blocks) {
+		auto found = active_blocks.find(block.first);
+		if (found != active_blocks.end()) {
+			glUniformBlockBinding(program_id, found->second, block.second);
+		}
+	}
+
+	glUseProgram(program_id);
+	for (const auto& sampler : bindings.samplers) {
+		const GLint location = uniformLocation(sampler.first);
+		if (location >= 0) {
+			glUniform1i(location, sampler.second);
+		}
+	}
+	glUseProgram(0);
+}
+
+void ShaderProgram::reflect() {
+	GLint uniform_count = 0;
+	GLint max_name_length = 0;
+	glGetProgramiv(program_id, GL_ACTIVE_UNIFORMS, &uniform_count);
+	glGetProgramiv(program_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+
+	std::string name(static_cast<size_t>(std::max(max_name_length, 1)), '\0');
+	for (GLint index = 0; index < uniform_count; index++) {
+		GLsizei length = 0;
+		Uniform uniform{ -1, 0, 0 };
+		glGetActiveUniform(program_id, static_cast<GLuint>(index), max_name_length,
+			&length, &uniform.size, &uniform.type, &name[0]);
+
+		std::string uniform_name = name.substr(0, static_cast<size_t>(length));
+		const size_t bracket = uniform_name.find("[0]");
+		if (bracket != std::string::npos) {
+			uniform_name.erase(bracket);
+		}
+
+		// Membros de blocos nao tem location; o valor vem do buffer.
+		uniform.location = glGetUniformLocation(program_id, uniform_name.c_str());
+		if (uniform.location >= 0) {
+			active_uniforms.emplace(uniform_name, uniform);
+		}
+	}
+
+	GLint block_count = 0;
+	GLint max_block_name_length = 0;
+	glGetProgramiv(program_id, GL_ACTIVE_UNIFORM_BLOCKS, &block_count);
+	glGetProgramiv(program_id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_block_name_length);
+
+	std::string block_name(static_cast<size_t>(std::max(max_block_name_length, 1)), '\0');
+	for (GLint index = 0; index < block_count; index++) {
+		GLsizei length = 0;
+		glGetActiveUniformBlockName(program_id, static_cast<GLuint>(index),
+			max_block_name_length, &length, &block_name[0]);
+		active_blocks.emplace(block_name.substr(0, static_cast<size_t>(length)),
+			static_cast<GLuint>(index));
+	}
+}
+
+GLint ShaderProgram::uniformLocation(const std::string& name) const {
+	auto found = active_uniforms.find(name);
+	return found != active_uniforms.end() ? found->second.location : -1;
+}
+
+bool ShaderProgram::hasBlock(const std::string& name) const {
+	return active_blocks.find(name) != active_blocks.end();
+}
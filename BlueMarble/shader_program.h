@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <GL/glew.h>
+
+// Pontos de ligacao fixos aplicados a todo programa logo depois do link:
+// unidade de textura de cada sampler e binding de cada bloco de uniforms.
+// Com isso o render loop so liga texturas e buffers, sem glUniform por quadro.
+struct ProgramBindings {
+	std::vector<std::pair<std::string, GLint>> samplers;
+	std::vector<std::pair<std::string, GLuint>> blocks;
+};
+
+// Programa linkado com os uniforms e blocos ativos refletidos uma vez, na
+// criacao. Nao e dono do id; quem apaga o programa e o ShaderCompiler.
+class ShaderProgram {
+public:
+	struct Uniform {
+		GLint location;
+		GLenum type;
+		// Elementos, para arrays.
+		GLint size;
+	};
+
+	ShaderProgram() = default;
+	// Reflete os uniforms e blocos ativos e aplica bindings; usa o programa
+	// (glUseProgram) para os samplers e deixa 0 ligado.
+	ShaderProgram(GLuint program_id, const ProgramBindings& bindings);
+
+	GLuint id() const { return program_id; }
+
+	// -1 se o uniform nao existe ou foi eliminado pelo compilador. Arrays
+	// aparecem pelo nome sem "[0]".
+	GLint uniformLocation(const std::string& name) const;
+	bool hasBlock(const std::string& name) const;
+
+	const std::unordered_map<std::string, Uniform>& uniforms() const { return active_uniforms; }
+
+private:
+	void reflect();
+
+	GLuint program_id = 0;
+	std::unordered_map<std::string, Uniform> active_uniforms;
+	std::unordered_map<std::string, GLuint> active_blocks;
+};
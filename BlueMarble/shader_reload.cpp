@@ -0,0 +1,244 @@
+#include "shader_reload.h"
+
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+
+#include <GLFW/glfw3.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr int watch_interval_ms = 250;
+// Editores gravam em rajadas (truncar, escrever, renomear); espera a rajada
+// acabar antes de compilar.
+constexpr int settle_ms = 50;
+
+std::string fileName(const std::string& path) {
+	return std::filesystem::path(path).filename().string();
+}
+
+}
+
+ShaderReloader::~ShaderReloader() {
+	// Sem contexto GL aqui; so garante que a thread nao fique solta.
+	stopWorker();
+}
+
+bool ShaderReloader::start(GLFWwindow* shared_window, const std::string& directory) {
+	this->directory = directory;
+
+#ifdef __linux__
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd < 0 ||
+		inotify_add_watch(inotify_fd, directory.c_str(),
+			IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+		std::cout << "Erro ao observar shaders - " << directory << std::endl;
+		release();
+		return false;
+	}
+#else
+	// Primeira varredura so registra as datas.
+	scanModificationTimes();
+#endif
+
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	context_window = glfwCreateWindow(1, 1, "", nullptr, shared_window);
+	glfwDefaultWindowHints();
+
+	if (context_window == nullptr) {
+		std::cout << "Erro ao criar contexto para recarga de shaders" << std::endl;
+		release();
+		return false;
+	}
+
+	stopping = false;
+	worker = std::thread(&ShaderReloader::run, this);
+
+	std::cout << "Recarga de shaders ligada - " << directory << std::endl;
+	return true;
+}
+
+std::vector<std::string> ShaderReloader::waitForChanges() {
+	std::vector<std::string> names;
+
+#ifdef __linux__
+	pollfd descriptor{ inotify_fd, POLLIN, 0 };
+	if (poll(&descriptor, 1, watch_interval_ms) <= 0) {
+		return names;
+	}
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(settle_ms));
+
+	alignas(inotify_event) char buffer[4096];
+	ssize_t length = 0;
+	while ((length = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+		for (ssize_t offset = 0; offset < length;) {
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			if (event->len > 0) {
+				names.push_back(event->name);
+			}
+			offset += sizeof(inotify_event) + event->len;
+		}
+	}
+#else
+	std::this_thread::sleep_for(std::chrono::milliseconds(watch_interval_ms));
+	names = scanModificationTimes();
+#endif
+
+	return names;
+}
+
+#ifndef __linux__
+std::vector<std::string> ShaderReloader::scanModificationTimes() {
+	std::vector<std::string> names;
+
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+		const long long time = static_cast<long long>(
+			entry.last_write_time(error).time_since_epoch().count());
+		const std::string name = entry.path().filename().string();
+
+		auto found = modification_times.find(name);
+		if (found == modification_times.end()) {
+			modification_times.emplace(name, time);
+		} else if (found->second != time) {
+			found->second = time;
+			names.push_back(name);
+		}
+	}
+
+	return names;
+}
+#endif
+
+void ShaderReloader::run() {
+	glfwMakeContextCurrent(context_window);
+
+	for (;;) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (stopping) {
+				break;
+			}
+		}
+
+		const std::vector<std::string> names = waitForChanges();
+		if (names.empty()) {
+			continue;
+		}
+
+		std::vector<watchedProgram> programs;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			programs = watched;
+		}
+
+		bool include_changed = false;
+		for (const std::string& name : names) {
+			bool main_file = false;
+			for (const watchedProgram& program : programs) {
+				main_file = main_file || name == fileName(program.source.vertex_file) ||
+					name == fileName(program.source.fragment_file);
+			}
+			include_changed = include_changed || !main_file;
+		}
+
+		for (const watchedProgram& program : programs) {
+			bool changed = include_changed;
+			for (const std::string& name : names) {
+				changed = changed || name == fileName(program.source.vertex_file) ||
+					name == fileName(program.source.fragment_file);
+			}
+
+			if (!changed) {
+				continue;
+			}
+
+			std::cout << "Recarregando shaders - " << program.source.vertex_file << ", "
+				<< program.source.fragment_file << std::endl;
+
+			GLuint program_id = buildProgram(program.source);
+			if (program_id == 0) {
+				std::cout << "Mantendo o programa anterior" << std::endl;
+				continue;
+			}
+
+			// A fence garante que o link terminou antes do contexto principal
+			// usar o programa.
+			GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			glFlush();
+
+			std::lock_guard<std::mutex> lock(mutex);
+			reloaded.push_back(reloadedProgram{ program.handle, program_id, fence });
+		}
+	}
+
+	glfwMakeContextCurrent(nullptr);
+}
+
+void ShaderReloader::update(ShaderCompiler& compiler) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Programas novos (variantes pedidas desde o ultimo quadro).
+	for (size_t handle = watched.size(); handle < compiler.size(); handle++) {
+		watched.push_back(watchedProgram{ handle, compiler.source(handle) });
+	}
+
+	size_t kept = 0;
+	for (size_t index = 0; index < reloaded.size(); index++) {
+		reloadedProgram& program = reloaded[index];
+
+		const GLenum state = glClientWaitSync(program.fence, 0, 0);
+		if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED) {
+			reloaded[kept++] = program;
+			continue;
+		}
+
+		glDeleteSync(program.fence);
+		compiler.replace(program.handle, program.program_id);
+		std::cout << "Programa recarregado" << std::endl;
+	}
+	reloaded.resize(kept);
+}
+
+void ShaderReloader::stopWorker() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	if (worker.joinable()) {
+		worker.join();
+	}
+}
+
+void ShaderReloader::release() {
+	stopWorker();
+
+	for (reloadedProgram& program : reloaded) {
+		glDeleteSync(program.fence);
+		glDeleteProgram(program.program_id);
+	}
+	reloaded.clear();
+	watched.clear();
+
+	if (context_window != nullptr) {
+		glfwDestroyWindow(context_window);
+		context_window = nullptr;
+	}
+
+#ifdef __linux__
+	if (inotify_fd >= 0) {
+		close(inotify_fd);
+		inotify_fd = -1;
+	}
+#else
+	modification_times.clear();
+#endif
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "shader_compiler.h"
+
+struct GLFWwindow;
+
+// Recarrega shaders editados sem parar o render loop. Uma thread observa a
+// pasta dos shaders (inotify no Linux; nos outros sistemas compara a data de
+// modificacao a cada 250 ms) e recompila os programas afetados em um contexto
+// GL escondido que compartilha objetos com a janela principal. Todo programa
+// enviado ao ShaderCompiler e observado; um arquivo que nao e o fonte
+// principal de nenhum programa pode ser um include, entao recompila todos.
+//
+// O programa novo so entra no lugar do antigo em update(), na thread do GL,
+// depois do link dar certo e da fence criada no contexto de fundo sinalizar.
+// Se a compilacao falhar o erro e mostrado e o ultimo programa bom continua
+// em uso.
+class ShaderReloader {
+public:
+	ShaderReloader() = default;
+	~ShaderReloader();
+
+	ShaderReloader(const ShaderReloader&) = delete;
+	ShaderReloader& operator=(const ShaderReloader&) = delete;
+
+	// Cria o contexto compartilhado; precisa rodar na thread principal.
+	bool start(GLFWwindow* shared_window, const std::string& directory);
+
+	void update(ShaderCompiler& compiler);
+
+	void release();
+
+private:
+	struct watchedProgram {
+		ShaderCompiler::Handle handle;
+		ProgramSource source;
+	};
+
+	struct reloadedProgram {
+		ShaderCompiler::Handle handle;
+		GLuint program_id;
+		GLsync fence;
+	};
+
+	void run();
+	void stopWorker();
+	// Nomes dos arquivos alterados; espera no maximo ~250 ms.
+	std::vector<std::string> waitForChanges();
+
+	std::string directory;
+	GLFWwindow* context_window = nullptr;
+
+	std::thread worker;
+	std::mutex mutex;
+	bool stopping = false;
+	std::vector<watchedProgram> watched;
+	std::vector<reloadedProgram> reloaded;
+
+#ifdef __linux__
+	int inotify_fd = -1;
+#else
+	// Arquivos novos ou com data diferente da ultima varredura.
+	std::vector<std::string> scanModificationTimes();
+
+	std::map<std::string, long long> modification_times;
+#endif
+};
@@ -0,0 +1,72 @@
+#include "shader_variants.h"
+
+#include <iostream>
+
+const char* shaderFeatureDefine(ShaderFeature feature) {
+	switch (feature) {
+	case ShaderFeature::PackedVertex:
+		return "PACKED_VERTEX";
+	case ShaderFeature::ProceduralSphere:
+		return "PROCEDURAL_SPHERE";
+	case ShaderFeature::LodPatch:
+		return "LOD_PATCH";
+	case ShaderFeature::SphericalUV:
+		return "SPHERICAL_UV";
+	case ShaderFeature::Specular:
+		return "SPECULAR";
+	case ShaderFeature::GlobeLayers:
+		return "GLOBE_LAYERS";
+	case ShaderFeature::NightLayer:
+		return "NIGHT_LAYER";
+	case ShaderFeature::CloudLayer:
+		return "CLOUD_LAYER";
+	case ShaderFeature::SpecularLayer:
+		return "SPECULAR_LAYER";
+	case ShaderFeature::CubeTexture:
+		return "CUBE_TEXTURE";
+	case ShaderFeature::VirtualTexture:
+		return "VIRTUAL_TEXTURE";
+	case ShaderFeature::VirtualFeedback:
+		return "VIRTUAL_FEEDBACK";
+	}
+	return "";
+}
+
+std::string shaderDefines(ShaderFeatures features) {
+	std::string defines;
+	for (size_t index = 0; index < shader_feature_count; index++) {
+		const ShaderFeature feature = static_cast<ShaderFeature>(index);
+		if (features & shaderFeatureBit(feature)) {
+			defines += "#define ";
+			defines += shaderFeatureDefine(feature);
+			defines += "\n";
+		}
+	}
+	return defines;
+}
+
+ShaderVariants::ShaderVariants(ShaderCompiler& compiler, const std::string& vertex_file,
+							   const std::string& fragment_file)
+	: compiler(compiler), vertex_file(vertex_file), fragment_file(fragment_file) {
+}
+
+const ShaderProgram* ShaderVariants::program(ShaderFeatures features) {
+	auto found = variants.find(features);
+	if (found == variants.end()) {
+		std::cout << "Variante de shader - " << vertex_file << ", " << fragment_file
+			<< " [";
+		for (size_t index = 0; index < shader_feature_count; index++) {
+			const ShaderFeature feature = static_cast<ShaderFeature>(index);
+			if (features & shaderFeatureBit(feature)) {
+				std::cout << " " << shaderFeatureDefine(feature);
+			}
+		}
+		std::cout << " ]" << std::endl;
+
+		const ShaderCompiler::Handle handle = compiler.submit(
+			ProgramSource{ vertex_file, fragment_file, shaderDefines(features) });
+		found = variants.emplace(features, handle).first;
+	}
+
+	return compiler.program(found->second);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "shader_compiler.h"
+
+// Recursos do shader do globo resolvidos na compilacao. Cada um vira um
+// #define com o nome de shaderFeatureDefine, e cada combinacao usada vira um
+// programa proprio, sem os ramos dos recursos desligados.
+enum class ShaderFeature {
+	PackedVertex,
+	ProceduralSphere,
+	LodPatch,
+	SphericalUV,
+	Specular,
+	GlobeLayers,
+	// Camadas presentes na array de GlobeLayers (globe_layers.h).
+	NightLayer,
+	CloudLayer,
+	SpecularLayer,
+	CubeTexture,
+	VirtualTexture,
+	VirtualFeedback
+};
+
+constexpr size_t shader_feature_count = 12;
+
+using ShaderFeatures = std::uint32_t;
+
+constexpr ShaderFeatures shaderFeatureBit(ShaderFeature feature) {
+	return ShaderFeatures{ 1 } << static_cast<std::uint32_t>(feature);
+}
+
+const char* shaderFeatureDefine(ShaderFeature feature);
+
+// Linhas "#define ..." das features ligadas, em ordem fixa.
+std::string shaderDefines(ShaderFeatures features);
+
+// Programas de um par de arquivos por combinacao de features. Uma variante so
+// e enviada ao ShaderCompiler na primeira vez que e pedida.
+class ShaderVariants {
+public:
+	ShaderVariants(ShaderCompiler& compiler, const std::string& vertex_file,
+				   const std::string& fragment_file);
+
+	// nullptr enquanto a variante compila ou se falhou.
+	const ShaderProgram* program(ShaderFeatures features);
+
+	size_t variantCount() const { return variants.size(); }
+
+private:
+	ShaderCompiler& compiler;
+	std::string vertex_file;
+	std::string fragment_file;
+	std::map<ShaderFeatures, ShaderCompiler::Handle> variants;
+};
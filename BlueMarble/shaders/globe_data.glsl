@@ -0,0 +1,25 @@
+// Blocos compartilhados pelos programas do globo; o layout std140 e espelhado
+// por FrameData e ObjectData em globe_uniforms.h.
+layout(std140) uniform FrameData {
+	mat4 view;
+	mat4 projection;
+	// xyz no espaco da camera.
+	vec4 light_direction;
+	float light_intensity;
+	float specular_exponent;
+};
+
+layout(std140) uniform ObjectData {
+	mat4 model_view_projection;
+	mat4 model_view;
+	mat4 matrix_normal;
+	// xyz no espaco do objeto.
+	vec4 camera_object_position;
+	// Relevo: deslocamento (em raios) das alturas 0 e 1 e fator de exagero.
+	vec2 relief_range;
+	float relief_exaggeration;
+	// LOD_PATCH: lado da grade de cada patch.
+	float lod_grid_resolution;
+	// PROCEDURAL_SPHERE: resolucao da grade UV.
+	int sphere_resolution;
+};
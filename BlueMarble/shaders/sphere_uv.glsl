@@ -0,0 +1,8 @@
+// Convencao da grade UV compartilhada pelos dois estagios: u = phi / 2pi,
+// v = theta / pi, com o corte de u em phi = pi.
+const float pi = 3.14159265f;
+
+vec2 equirectangularUV(vec3 direction){
+	return vec2(atan(direction.y, direction.x) / (2.0f * pi),
+				acos(clamp(direction.z, -1.0f, 1.0f)) / pi);
+}
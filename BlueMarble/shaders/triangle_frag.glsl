@@ -1,37 +1,181 @@
 #version 330 core
+// Features da variante (shader_variants.h): SPHERICAL_UV, SPECULAR,
+// GLOBE_LAYERS (com NIGHT_LAYER, CLOUD_LAYER e SPECULAR_LAYER), CUBE_TEXTURE,
+// VIRTUAL_TEXTURE e VIRTUAL_FEEDBACK.
+#inject
+#include "sphere_uv.glsl"
+#include "globe_data.glsl"
 
 in vec3 color;
 in vec2 uv;
 in vec3 normal;
+in vec3 object_direction;
+in vec3 view_position;
 
 uniform sampler2D texture_sampler;
-uniform vec3 light_direction;
-uniform float light_intensity;
+// Inclinacao do relevo (metros por metro, leste e sul).
+uniform sampler2D slope_sampler;
+// GLOBE_LAYERS: dia e as camadas presentes de noite, nuvens e mascara
+// especular, nessa ordem (globe_layers.h), em um unico sampler.
+uniform sampler2DArray layer_sampler;
+
+#ifdef NIGHT_LAYER
+#define NIGHT_LAYERS 1
+#else
+#define NIGHT_LAYERS 0
+#endif
+#ifdef CLOUD_LAYER
+#define CLOUD_LAYERS 1
+#else
+#define CLOUD_LAYERS 0
+#endif
+
+const float night_layer = 1.0f;
+const float cloud_layer = float(1 + NIGHT_LAYERS);
+const float specular_layer = float(1 + NIGHT_LAYERS + CLOUD_LAYERS);
+// CUBE_TEXTURE: cubemap reprojetado no bake (texture_cubemap.h), buscado pela
+// direcao no espaco do objeto.
+uniform samplerCube cube_sampler;
+// VIRTUAL_TEXTURE: atlas de paginas (virtual_texture.h), page table com um
+// mip por nivel e tamanho em texels de cada nivel da piramide.
+// VIRTUAL_FEEDBACK escreve as paginas pedidas em vez da cor.
+uniform sampler2D vt_atlas;
+uniform sampler2D vt_page_table;
+uniform vec2 vt_level_size[16];
+uniform int vt_max_level;
+uniform float vt_page_content;
+uniform float vt_page_border;
+uniform float vt_page_size;
+uniform float vt_atlas_size;
+uniform float vt_lod_bias;
 
 out vec4 out_color;
 
+// Entre as duas versoes de u (cortes em phi = 0 e phi = pi) usa a que e
+// continua no pixel, evitando a linha de mip errado na costura (Tarini 2012).
+vec2 sphericalUV(vec3 direction){
+	vec2 grid_uv = equirectangularUV(normalize(direction));
+	float u_wrapped = fract(grid_uv.x);
+
+	return vec2(fwidth(grid_uv.x) <= fwidth(u_wrapped) ? grid_uv.x : u_wrapped, grid_uv.y);
+}
+
+// Inclina a normal da malha contra o gradiente da altura, na base
+// leste/sul da esfera no ponto.
+vec3 reliefNormal(vec3 base_normal, vec3 direction){
+	vec3 d = normalize(direction);
+	vec2 slope = texture(slope_sampler, sphericalUV(d)).rg * relief_exaggeration;
+
+	vec2 east_xy = vec2(-d.y, d.x);
+	if (dot(east_xy, east_xy) < 1e-12f){
+		return base_normal;
+	}
+
+	vec3 east = vec3(normalize(east_xy), 0.0f);
+	vec3 south = cross(east, d);
+	vec3 tilt = mat3(matrix_normal) * (slope.x * east + slope.y * south);
+	return normalize(base_normal - tilt);
+}
+
+// Nivel da piramide pelas derivadas do uv em texels do nivel 0; recebe o uv
+// sem fract para nao ver a costura como uma derivada enorme.
+int virtualLevel(vec2 texture_uv){
+	vec2 texel = texture_uv * vt_level_size[0];
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float lod = 0.5f * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8f)) + vt_lod_bias;
+	return clamp(int(floor(lod)), 0, vt_max_level);
+}
+
+ivec2 virtualPage(vec2 texture_uv, int level){
+	vec2 size = vt_level_size[level];
+	ivec2 pages = ivec2(ceil(size / vt_page_content));
+	return clamp(ivec2(floor(texture_uv * size / vt_page_content)), ivec2(0), pages - 1);
+}
+
+// Mesma codificacao lida em VirtualTexture::readFeedback: x e y da pagina em
+// 12 bits e nivel + 1 no alfa (0 = sem pedido).
+vec4 virtualFeedback(vec2 texture_uv){
+	int level = virtualLevel(texture_uv);
+	ivec2 page = virtualPage(vec2(fract(texture_uv.x), texture_uv.y), level);
+	return vec4(page.x & 255, page.y & 255, (page.x >> 8) | ((page.y >> 8) << 4), level + 1) / 255.0f;
+}
+
+vec3 virtualTexture(vec2 texture_uv){
+	int level = virtualLevel(texture_uv);
+	vec2 wrapped_uv = vec2(fract(texture_uv.x), texture_uv.y);
+	ivec2 page = virtualPage(wrapped_uv, level);
+
+	// A entrada aponta para a pagina residente, ou para o ancestral mais
+	// proximo; o texel e recalculado no nivel que de fato esta no atlas.
+	vec4 entry = texelFetch(vt_page_table, page, level) * 255.0f;
+	int mapped_level = int(entry.b + 0.5f);
+
+	vec2 texel = wrapped_uv * vt_level_size[mapped_level];
+	vec2 in_page = texel - floor(texel / vt_page_content) * vt_page_content;
+	in_page = clamp(in_page, vec2(0.5f - vt_page_border), vec2(vt_page_content + vt_page_border - 0.5f));
+
+	vec2 atlas_texel = floor(entry.rg + 0.5f) * vt_page_size + vt_page_border + in_page;
+	return textureLod(vt_atlas, atlas_texel / vt_atlas_size, 0.0f).rgb;
+}
+
 void main(){
 
-	vec3 n = normalize(normal);
-	vec3 l = -normalize(light_direction);
+#ifdef SPHERICAL_UV
+	vec2 texture_uv = sphericalUV(object_direction);
+#else
+	vec2 texture_uv = uv;
+#endif
+
+#ifdef VIRTUAL_FEEDBACK
+	out_color = virtualFeedback(texture_uv);
+#else
+	vec3 n = reliefNormal(normalize(normal), object_direction);
+	vec3 l = -normalize(light_direction.xyz);
 
 	float lambertian = max(dot(n, l), 0.05f);
 
-	vec3 view_direction = vec3(0.0f, 0.0f, -1.0f);
-	vec3 v = -view_direction;
+#if defined(VIRTUAL_TEXTURE)
+	vec3 texture_color = virtualTexture(texture_uv);
+#elif defined(CUBE_TEXTURE)
+	vec3 texture_color = texture(cube_sampler, object_direction).rgb;
+#elif defined(GLOBE_LAYERS)
+	vec3 texture_color = texture(layer_sampler, vec3(texture_uv, 0.0f)).rgb;
+#else
+	vec3 texture_color = texture(texture_sampler, texture_uv).rgb;
+#endif
+
+	vec3 final_color = texture_color * light_intensity * lambertian;
+
+	// Brilho so no lado iluminado; o fator substitui o if por pixel.
+#ifdef SPECULAR
+	vec3 v = normalize(-view_position);
 	vec3 r = reflect(-l, n);
+	float specular = pow(max(dot(r, v), 0.0f), specular_exponent);
+	specular *= step(0.05f, dot(n, l));
 
-	float alpha = 100.0f;
-	float specular = pow(dot(r, v), alpha);
-	specular = max(specular, 0.0f);
-	vec3 final_color;
+#ifdef SPECULAR_LAYER
+	specular *= texture(layer_sampler, vec3(texture_uv, specular_layer)).r;
+#endif
 
-	vec3 texture_color = texture(texture_sampler, uv).rgb;
-	if( lambertian > 0.05f){
-		final_color = texture_color * light_intensity * lambertian + specular;
-	}else {
-		final_color = texture_color * light_intensity * lambertian;
-	}
+	final_color += vec3(specular);
+#endif
+
+	// Nuvens cobrem a superficie com branco iluminado; as luzes da noite
+	// aparecem onde o sol se poe, atenuadas pelas nuvens.
+#ifdef CLOUD_LAYER
+	float clouds = texture(layer_sampler, vec3(texture_uv, cloud_layer)).r;
+	final_color = mix(final_color, vec3(light_intensity * lambertian), clouds);
+#else
+	float clouds = 0.0f;
+#endif
+
+#ifdef NIGHT_LAYER
+	vec3 night = texture(layer_sampler, vec3(texture_uv, night_layer)).rgb;
+	float darkness = 1.0f - smoothstep(0.0f, 0.2f, dot(n, l));
+	final_color += night * darkness * (1.0f - clouds);
+#endif
 
 	out_color = vec4(final_color, 1.0f);
-}
\ No newline at end of file
+#endif
+}
@@ -1,21 +1,125 @@
 #version 330 core
+// Features da variante (shader_variants.h): PACKED_VERTEX,
+// PROCEDURAL_SPHERE e LOD_PATCH.
+#inject
+#include "sphere_uv.glsl"
+#include "globe_data.glsl"
 
 layout (location = 0) in vec3 in_position;
 layout (location = 1) in vec3 in_normal;
 layout (location = 2) in vec3 in_color;
 layout (location = 3) in vec2 in_uv;
+layout (location = 4) in vec4 in_patch;
+layout (location = 5) in vec2 in_morph;
 
-uniform mat4 model_view_projection;
-uniform mat4 matrix_normal;
+// PROCEDURAL_SPHERE: esfera sem atributos (sphere_resolution em ObjectData).
+// LOD_PATCH: patch instanciado do GlobeLod. in_position.xy e a coordenada na
+// grade, in_patch = (face, deslocamento, tamanho) e in_morph = (inicio, fim).
+// Relevo: altura normalizada do heightmap.
+uniform sampler2D height_sampler;
 
 out vec3 color;
 out vec2 uv;
 out vec3 normal;
+out vec3 object_direction;
+out vec3 view_position;
 
 
+vec3 decodeOctahedral(vec2 encoded){
+	vec3 n = vec3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	if (n.z < 0.0f){
+		vec2 signs = vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+		n.xy = (1.0f - abs(n.yx)) * signs;
+	}
+	return normalize(n);
+}
+
+// Mesma grade de generateSphereMesh desenhada como uma triangle strip por
+// linha, com um vertice repetido no inicio e no fim de cada linha.
+void proceduralVertex(out vec3 position, out vec2 texcoord){
+	int row_vertices = 2 * sphere_resolution + 2;
+	int row = gl_VertexID / row_vertices;
+	int strip_index = clamp(gl_VertexID - row * row_vertices - 1,
+							0, 2 * sphere_resolution - 1);
+
+	float inv_resolution = 1.0f / float(sphere_resolution - 1);
+	float u = float(row + (strip_index & 1)) * inv_resolution;
+	float v = float(strip_index >> 1) * inv_resolution;
+
+	float theta = u * pi;
+	float phi = v * 2.0f * pi;
+
+	position = vec3(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));
+	texcoord = vec2(v, u);
+}
+
+// Mesma tabela de cubeSphereFace em sphere_mesh.cpp.
+const vec3 face_normal[6] = vec3[6](
+	vec3( 1.0f, 0.0f, 0.0f), vec3(-1.0f, 0.0f, 0.0f), vec3( 0.0f, 1.0f, 0.0f),
+	vec3( 0.0f,-1.0f, 0.0f), vec3( 0.0f, 0.0f, 1.0f), vec3( 0.0f, 0.0f,-1.0f));
+const vec3 face_right[6] = vec3[6](
+	vec3( 0.0f, 1.0f, 0.0f), vec3( 0.0f, 0.0f, 1.0f), vec3( 0.0f, 0.0f, 1.0f),
+	vec3( 1.0f, 0.0f, 0.0f), vec3( 1.0f, 0.0f, 0.0f), vec3( 0.0f, 1.0f, 0.0f));
+const vec3 face_up[6] = vec3[6](
+	vec3( 0.0f, 0.0f, 1.0f), vec3( 0.0f, 1.0f, 0.0f), vec3( 1.0f, 0.0f, 0.0f),
+	vec3( 0.0f, 0.0f, 1.0f), vec3( 0.0f, 1.0f, 0.0f), vec3( 1.0f, 0.0f, 0.0f));
+
+float cubeWarp(float s){
+	return abs(s) >= 1.0f ? sign(s) : tan(s * 0.78539816f);
+}
+
+vec3 cubeToSphere(int face, vec2 s){
+	return normalize(face_normal[face] + face_right[face] * cubeWarp(s.x) +
+					 face_up[face] * cubeWarp(s.y));
+}
+
+// Vertices impares da grade deslizam para o vizinho par conforme a
+// distancia ate a camera entra na faixa de morph do nivel.
+vec3 lodVertex(){
+	int face = int(in_patch.x + 0.5f);
+	float cell = in_patch.w / lod_grid_resolution;
+	vec2 grid = in_position.xy;
+
+	vec3 position = cubeToSphere(face, in_patch.yz + grid * cell);
+	float morph = clamp((distance(position, camera_object_position.xyz) - in_morph.x) /
+						(in_morph.y - in_morph.x), 0.0f, 1.0f);
+
+	grid -= fract(grid * 0.5f) * 2.0f * morph;
+	return cubeToSphere(face, in_patch.yz + grid * cell);
+}
+
+// A costura nao importa aqui porque o heightmap repete em u.
+vec3 displace(vec3 position){
+	vec3 direction = normalize(position);
+	float height = textureLod(height_sampler, equirectangularUV(direction), 0.0f).r;
+	return position * (1.0f + relief_exaggeration * mix(relief_range.x, relief_range.y, height));
+}
+
 void main(){
-	normal = vec3(matrix_normal * vec4(in_normal, 0.0f));
+	vec3 object_position = in_position;
+	vec3 object_normal;
+	vec2 object_uv = in_uv;
+
+#if defined(LOD_PATCH)
+	object_position = lodVertex();
+	object_normal = object_position;
+#elif defined(PROCEDURAL_SPHERE)
+	proceduralVertex(object_position, object_uv);
+	object_normal = object_position;
+#elif defined(PACKED_VERTEX)
+	// packedVertex (vertex_format.h): normal octaedrica e u guardado como u / 2.
+	object_normal = decodeOctahedral(in_normal.xy);
+	object_uv.x *= 2.0f;
+#else
+	object_normal = in_normal;
+#endif
+
+	vec4 displaced = vec4(displace(object_position), 1.0f);
+
+	normal = vec3(matrix_normal * vec4(object_normal, 0.0f));
 	color = in_color;
-	uv = in_uv;
-	gl_Position = model_view_projection * vec4(in_position, 1.0f);
+	uv = object_uv;
+	object_direction = object_position;
+	view_position = vec3(model_view * displaced);
+	gl_Position = model_view_projection * displaced;
 }
\ No newline at end of file
@@ -0,0 +1,574 @@
+#include "sphere_mesh.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+#include <glm/ext.hpp>
+
+#include "parallel.h"
+
+namespace {
+
+void reportGeneration(const char* name, GLuint resolution, size_t num_vertices,
+					size_t num_triangles,
+					std::chrono::steady_clock::time_point start_time) {
+	const std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - start_time;
+	const double seconds = std::max(elapsed.count(), 1e-9);
+
+	std::cout << "Esfera gerada (" << name << ") - resolucao " << resolution
+		<< ", " << num_vertices << " vertices, " << num_triangles
+		<< " triangulos em " << seconds * 1000.0 << " ms ("
+		<< static_cast<size_t>(num_vertices / seconds) << " vertices/s)"
+		<< std::endl;
+}
+
+vertex sphereVertex(const glm::vec3& position) {
+	return vertex{
+		position,
+		position,
+		glm::vec3{1.0f, 1.0f, 1.0f},
+		glm::vec2{0.0f, 0.0f}
+	};
+}
+
+float longitudeU(const glm::vec3& position) {
+	float u = std::atan2(position.y, position.x) / glm::two_pi<float>();
+	if (u < 0.0f) {
+		u += 1.0f;
+	}
+	return u;
+}
+
+// Calcula o uv equiretangular (mesma convencao da grade UV: u = phi / 2pi,
+// v = theta / pi) e duplica vertices onde a textura precisa ser cortada:
+// triangulos que cruzam a costura em u = 0 recebem copias com u + 1 e os
+// vertices dos polos recebem uma copia por triangulo com o u medio dos
+// outros dois vertices.
+void assignSphericalUVs(std::vector<vertex>& vertex_buf,
+					std::vector<glm::ivec3>& indices) {
+	constexpr float pole_epsilon = 1e-6f;
+
+	for (vertex& v : vertex_buf) {
+		v.uv = glm::vec2{
+			longitudeU(v.position),
+			std::acos(glm::clamp(v.position.z, -1.0f, 1.0f)) / glm::pi<float>()
+		};
+	}
+
+	std::unordered_map<int, int> seam_copies;
+
+	for (glm::ivec3& triangle : indices) {
+		bool is_pole[3];
+		float u[3];
+		for (int corner = 0; corner < 3; corner++) {
+			const vertex& v = vertex_buf[triangle[corner]];
+			is_pole[corner] = 1.0f - std::abs(v.position.z) < pole_epsilon;
+			u[corner] = v.uv.x;
+		}
+
+		float u_min = 2.0f;
+		float u_max = -1.0f;
+		for (int corner = 0; corner < 3; corner++) {
+			if (!is_pole[corner]) {
+				u_min = std::min(u_min, u[corner]);
+				u_max = std::max(u_max, u[corner]);
+			}
+		}
+
+		if (u_max - u_min > 0.5f) {
+			for (int corner = 0; corner < 3; corner++) {
+				if (is_pole[corner] || u[corner] >= 0.5f) {
+					continue;
+				}
+
+				const int original = triangle[corner];
+				auto found = seam_copies.find(original);
+				if (found == seam_copies.end()) {
+					vertex copy = vertex_buf[original];
+					copy.uv.x += 1.0f;
+					vertex_buf.push_back(copy);
+					found = seam_copies.emplace(original,
+						static_cast<int>(vertex_buf.size() - 1)).first;
+				}
+
+				triangle[corner] = found->second;
+				u[corner] += 1.0f;
+			}
+		}
+
+		for (int corner = 0; corner < 3; corner++) {
+			if (!is_pole[corner]) {
+				continue;
+			}
+
+			float u_sum = 0.0f;
+			int u_count = 0;
+			for (int other = 0; other < 3; other++) {
+				if (!is_pole[other]) {
+					u_sum += u[other];
+					u_count++;
+				}
+			}
+
+			vertex copy = vertex_buf[triangle[corner]];
+			copy.uv.x = u_count > 0 ? u_sum / u_count : 0.0f;
+			vertex_buf.push_back(copy);
+			triangle[corner] = static_cast<int>(vertex_buf.size() - 1);
+		}
+	}
+}
+
+}
+
+const CubeFace& cubeSphereFace(size_t face) {
+	static const std::array<CubeFace, cube_face_count> faces{
+		CubeFace{ glm::vec3{ 1.0f, 0.0f, 0.0f}, glm::vec3{ 0.0f, 1.0f, 0.0f}, glm::vec3{ 0.0f, 0.0f, 1.0f} },
+		CubeFace{ glm::vec3{-1.0f, 0.0f, 0.0f}, glm::vec3{ 0.0f, 0.0f, 1.0f}, glm::vec3{ 0.0f, 1.0f, 0.0f} },
+		CubeFace{ glm::vec3{ 0.0f, 1.0f, 0.0f}, glm::vec3{ 0.0f, 0.0f, 1.0f}, glm::vec3{ 1.0f, 0.0f, 0.0f} },
+		CubeFace{ glm::vec3{ 0.0f,-1.0f, 0.0f}, glm::vec3{ 1.0f, 0.0f, 0.0f}, glm::vec3{ 0.0f, 0.0f, 1.0f} },
+		CubeFace{ glm::vec3{ 0.0f, 0.0f, 1.0f}, glm::vec3{ 1.0f, 0.0f, 0.0f}, glm::vec3{ 0.0f, 1.0f, 0.0f} },
+		CubeFace{ glm::vec3{ 0.0f, 0.0f,-1.0f}, glm::vec3{ 0.0f, 1.0f, 0.0f}, glm::vec3{ 1.0f, 0.0f, 0.0f} }
+	};
+	return faces[face];
+}
+
+float cubeSphereWarp(float s) {
+	if (std::abs(s) >= 1.0f) {
+		return s > 0.0f ? 1.0f : -1.0f;
+	}
+	return std::tan(s * glm::quarter_pi<float>());
+}
+
+glm::vec3 cubeToSphere(size_t face, const glm::vec2& s) {
+	const CubeFace& axes = cubeSphereFace(face);
+	return glm::normalize(axes.normal +
+		axes.right * cubeSphereWarp(s.x) + axes.up * cubeSphereWarp(s.y));
+}
+
+const char* sphereTopologyName(SphereTopology topology) {
+	switch (topology) {
+	case SphereTopology::UVSphere:
+		return "uv";
+	case SphereTopology::Icosphere:
+		return "ico";
+	case SphereTopology::CubeSphere:
+		return "cube";
+	}
+	return "?";
+}
+
+bool parseSphereTopology(const std::string& name, SphereTopology& topology) {
+	for (SphereTopology candidate : { SphereTopology::UVSphere,
+									  SphereTopology::Icosphere,
+									  SphereTopology::CubeSphere }) {
+		if (name == sphereTopologyName(candidate)) {
+			topology = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+GLuint sphereResolutionFor(SphereTopology topology, GLuint uv_resolution) {
+	assert(uv_resolution >= 2);
+
+	// Maior corda de cada malha vezes o numero de segmentos, medida nos
+	// geradores abaixo. Na grade UV e a diagonal do quad no equador; no cubo,
+	// a diagonal das celulas perto dos cantos.
+	constexpr float uv_max_edge = 7.025f;
+	constexpr float ico_max_edge = 1.324f;
+	constexpr float cube_max_edge = 2.222f;
+
+	const float uv_segments = static_cast<float>(uv_resolution - 1);
+
+	switch (topology) {
+	case SphereTopology::UVSphere:
+		return uv_resolution;
+	case SphereTopology::Icosphere:
+		return std::max<GLuint>(1, static_cast<GLuint>(
+			std::ceil(uv_segments * ico_max_edge / uv_max_edge)));
+	case SphereTopology::CubeSphere: {
+		// A resolucao precisa ser par para que o polo caia em um vertice.
+		const GLuint segments = static_cast<GLuint>(
+			std::ceil(uv_segments * cube_max_edge / uv_max_edge));
+		return std::max<GLuint>(2, segments + (segments & 1));
+	}
+	}
+	return uv_resolution;
+}
+
+size_t sphereMeshVertexCount(GLuint resolution) {
+	return static_cast<size_t>(resolution) * resolution;
+}
+
+size_t sphereMeshTriangleCount(GLuint resolution) {
+	return static_cast<size_t>(resolution - 1) * (resolution - 1) * 2;
+}
+
+void generateSphereMesh(GLuint resolution,
+					const SphereRowWriter& write_row,
+					GLuint* index_data,
+					bool reports
+					) {
+	assert(resolution >= 2);
+
+	const auto start_time = std::chrono::steady_clock::now();
+
+	constexpr float pi = glm::pi<float>();
+	constexpr float two_pi = glm::two_pi<float>();
+	const float inv_resolution = 1.0f / static_cast<float>(resolution - 1);
+
+	// Tabelas de seno/cosseno calculadas uma vez por linha (theta) e por
+	// coluna (phi) no lugar de sin/cos por vertice.
+	std::vector<float> sin_theta(resolution);
+	std::vector<float> cos_theta(resolution);
+	std::vector<float> sin_phi(resolution);
+	std::vector<float> cos_phi(resolution);
+
+	for (GLuint index = 0; index < resolution; index++) {
+		const float t = index * inv_resolution;
+		const float theta = glm::mix(0.0f, pi, t);
+		const float phi = glm::mix(0.0f, two_pi, t);
+
+		sin_theta[index] = glm::sin(theta);
+		cos_theta[index] = glm::cos(theta);
+		sin_phi[index] = glm::sin(phi);
+		cos_phi[index] = glm::cos(phi);
+	}
+
+	parallelFor(0, resolution, [&](size_t row_begin, size_t row_end) {
+		// Uma linha por vez em memoria; write_row leva ao destino final.
+		std::vector<vertex> row(resolution);
+
+		for (size_t u_index = row_begin; u_index < row_end; u_index++) {
+			const float u = u_index * inv_resolution;
+
+			for (GLuint v_index = 0; v_index < resolution; v_index++) {
+				const float v = v_index * inv_resolution;
+
+				const glm::vec3 vertex_position = {
+					sin_theta[u_index] * cos_phi[v_index],
+					sin_theta[u_index] * sin_phi[v_index],
+					cos_theta[u_index]
+				};
+
+				row[v_index] = vertex{
+					vertex_position,
+					glm::normalize(vertex_position),
+					glm::vec3{1.0f, 1.0f, 1.0f},
+					glm::vec2{v, u}
+				};
+			}
+
+			write_row(u_index * resolution, row.data(), resolution);
+		}
+
+		const size_t quad_row_end = std::min<size_t>(row_end, resolution - 1);
+		for (size_t u = row_begin; u < quad_row_end; u++) {
+			GLuint* row_indices = index_data + u * (resolution - 1) * 6;
+
+			for (GLuint v = 0; v < resolution - 1; v++) {
+				const GLuint p0 = static_cast<GLuint>(u) + v * resolution;
+				const GLuint p1 = static_cast<GLuint>(u + 1) + v * resolution;
+				const GLuint p2 = static_cast<GLuint>(u + 1) + (v + 1) * resolution;
+				const GLuint p3 = static_cast<GLuint>(u) + (v + 1) * resolution;
+
+				GLuint* quad = row_indices + v * 6;
+				quad[0] = p0;
+				quad[1] = p1;
+				quad[2] = p3;
+				quad[3] = p3;
+				quad[4] = p1;
+				quad[5] = p2;
+			}
+		}
+	}, 16);
+
+	if (reports) {
+		reportGeneration(sphereTopologyName(SphereTopology::UVSphere), resolution,
+			sphereMeshVertexCount(resolution), sphereMeshTriangleCount(resolution),
+			start_time);
+	}
+}
+
+void generateSphereMesh(GLuint resolution,
+					std::vector<vertex>& vertex_buf,
+					std::vector<glm::ivec3>& indices,
+					bool reports
+					) {
+	assert(resolution >= 2);
+
+	vertex_buf.clear();
+	vertex_buf.resize(sphereMeshVertexCount(resolution));
+	indices.clear();
+	indices.resize(sphereMeshTriangleCount(resolution));
+
+	vertex* vertex_data = vertex_buf.data();
+
+	generateSphereMesh(resolution,
+		[vertex_data](size_t first_vertex, const vertex* row, size_t count) {
+			std::copy(row, row + count, vertex_data + first_vertex);
+		},
+		reinterpret_cast<GLuint*>(indices.data()),
+		reports
+	);
+}
+
+void generateIcosphereMesh(GLuint frequency,
+					std::vector<vertex>& vertex_buf,
+					std::vector<glm::ivec3>& indices,
+					bool reports
+					) {
+	assert(frequency >= 1);
+
+	const auto start_time = std::chrono::steady_clock::now();
+
+	// Icosaedro com dois vertices nos polos (eixo z, como na grade UV) e dois
+	// aneis de cinco vertices em z = +-1/sqrt(5).
+	const float ring_z = 1.0f / std::sqrt(5.0f);
+	const float ring_radius = 2.0f / std::sqrt(5.0f);
+
+	std::array<glm::vec3, 12> corners;
+	corners[0] = glm::vec3{ 0.0f, 0.0f, 1.0f };
+	corners[11] = glm::vec3{ 0.0f, 0.0f, -1.0f };
+	for (int k = 0; k < 5; k++) {
+		const float upper_angle = glm::two_pi<float>() * k / 5.0f;
+		const float lower_angle = upper_angle + glm::pi<float>() / 5.0f;
+		corners[1 + k] = glm::vec3{ ring_radius * std::cos(upper_angle),
+									ring_radius * std::sin(upper_angle),
+									ring_z };
+		corners[6 + k] = glm::vec3{ ring_radius * std::cos(lower_angle),
+									ring_radius * std::sin(lower_angle),
+									-ring_z };
+	}
+
+	std::array<glm::ivec3, 20> faces;
+	for (int k = 0; k < 5; k++) {
+		const int upper = 1 + k;
+		const int upper_next = 1 + (k + 1) % 5;
+		const int lower = 6 + k;
+		const int lower_next = 6 + (k + 1) % 5;
+
+		faces[k] = glm::ivec3{ 0, upper, upper_next };
+		faces[5 + k] = glm::ivec3{ upper, lower, upper_next };
+		faces[10 + k] = glm::ivec3{ upper_next, lower, lower_next };
+		faces[15 + k] = glm::ivec3{ 11, lower_next, lower };
+	}
+
+	std::map<std::pair<int, int>, int> edge_ids;
+	std::vector<std::pair<int, int>> edges;
+	for (const glm::ivec3& face : faces) {
+		for (int side = 0; side < 3; side++) {
+			const int a = std::min(face[side], face[(side + 1) % 3]);
+			const int b = std::max(face[side], face[(side + 1) % 3]);
+			if (edge_ids.emplace(std::make_pair(a, b), static_cast<int>(edges.size())).second) {
+				edges.emplace_back(a, b);
+			}
+		}
+	}
+	assert(edges.size() == 30);
+
+	const GLuint n = frequency;
+	const size_t edge_vertices = n - 1;
+	const size_t face_vertices = n >= 3 ? static_cast<size_t>(n - 1) * (n - 2) / 2 : 0;
+	const size_t first_edge_vertex = corners.size();
+	const size_t first_face_vertex = first_edge_vertex + edges.size() * edge_vertices;
+
+	vertex_buf.clear();
+	vertex_buf.resize(first_face_vertex + faces.size() * face_vertices);
+	indices.clear();
+	indices.resize(faces.size() * n * n);
+
+	const float inv_frequency = 1.0f / static_cast<float>(n);
+
+	for (size_t corner = 0; corner < corners.size(); corner++) {
+		vertex_buf[corner] = sphereVertex(corners[corner]);
+	}
+
+	for (size_t edge = 0; edge < edges.size(); edge++) {
+		const glm::vec3& a = corners[edges[edge].first];
+		const glm::vec3& b = corners[edges[edge].second];
+		for (GLuint k = 1; k < n; k++) {
+			vertex_buf[first_edge_vertex + edge * edge_vertices + k - 1] =
+				sphereVertex(glm::normalize(glm::mix(a, b, k * inv_frequency)));
+		}
+	}
+
+	// Indice global do ponto (i, j) da face: i avanca de A para B e j de A
+	// para C. Pontos nas arestas sao compartilhados entre faces vizinhas.
+	auto edgeVertex = [&](int from, int to, GLuint step) -> int {
+		const int edge = edge_ids.at(std::make_pair(std::min(from, to), std::max(from, to)));
+		const GLuint k = from < to ? step : n - step;
+		return static_cast<int>(first_edge_vertex + edge * edge_vertices + k - 1);
+	};
+
+	parallelFor(0, faces.size(), [&](size_t face_begin, size_t face_end) {
+		std::vector<int> local((n + 1) * (n + 1), -1);
+
+		for (size_t face_index = face_begin; face_index < face_end; face_index++) {
+			const glm::ivec3& face = faces[face_index];
+			const glm::vec3& a = corners[face.x];
+			const glm::vec3& b = corners[face.y];
+			const glm::vec3& c = corners[face.z];
+
+			size_t next_face_vertex = first_face_vertex + face_index * face_vertices;
+
+			for (GLuint i = 0; i <= n; i++) {
+				for (GLuint j = 0; i + j <= n; j++) {
+					int index;
+					if (i == 0 && j == 0) {
+						index = face.x;
+					} else if (i == n) {
+						index = face.y;
+					} else if (j == n) {
+						index = face.z;
+					} else if (j == 0) {
+						index = edgeVertex(face.x, face.y, i);
+					} else if (i == 0) {
+						index = edgeVertex(face.x, face.z, j);
+					} else if (i + j == n) {
+						index = edgeVertex(face.y, face.z, j);
+					} else {
+						index = static_cast<int>(next_face_vertex++);
+						vertex_buf[index] = sphereVertex(glm::normalize(
+							a + (b - a) * (i * inv_frequency) + (c - a) * (j * inv_frequency)));
+					}
+					local[i * (n + 1) + j] = index;
+				}
+			}
+
+			glm::ivec3* triangle = indices.data() + face_index * n * n;
+			for (GLuint i = 0; i < n; i++) {
+				for (GLuint j = 0; i + j < n; j++) {
+					const int p00 = local[i * (n + 1) + j];
+					const int p10 = local[(i + 1) * (n + 1) + j];
+					const int p01 = local[i * (n + 1) + j + 1];
+					*triangle++ = glm::ivec3{ p00, p10, p01 };
+
+					if (i + j + 1 < n) {
+						const int p11 = local[(i + 1) * (n + 1) + j + 1];
+						*triangle++ = glm::ivec3{ p10, p11, p01 };
+					}
+				}
+			}
+		}
+	});
+
+	assignSphericalUVs(vertex_buf, indices);
+
+	if (reports) {
+		reportGeneration(sphereTopologyName(SphereTopology::Icosphere), frequency,
+			vertex_buf.size(), indices.size(), start_time);
+	}
+}
+
+void generateCubeSphereMesh(GLuint resolution,
+					std::vector<vertex>& vertex_buf,
+					std::vector<glm::ivec3>& indices,
+					bool reports
+					) {
+	assert(resolution >= 1);
+
+	const auto start_time = std::chrono::steady_clock::now();
+
+	const GLuint n = resolution;
+	const size_t face_side = n + 1;
+	const size_t face_vertices = face_side * face_side;
+	const size_t face_triangles = static_cast<size_t>(n) * n * 2;
+
+	// Distorcao por tangente deixa as celulas com area quase igual. A tabela
+	// e simetrica e termina exatamente em +-1 para que as arestas de faces
+	// vizinhas gerem exatamente as mesmas posicoes.
+	std::vector<float> warp(face_side);
+	for (GLuint i = 0; i <= n / 2; i++) {
+		const float t = 2.0f * i / static_cast<float>(n) - 1.0f;
+		warp[i] = i == 0 ? -1.0f : std::tan(t * glm::quarter_pi<float>());
+		warp[n - i] = -warp[i];
+	}
+	if (n % 2 == 0) {
+		warp[n / 2] = 0.0f;
+	}
+
+	vertex_buf.clear();
+	vertex_buf.resize(cube_face_count * face_vertices);
+	indices.clear();
+	indices.resize(cube_face_count * face_triangles);
+
+	parallelFor(0, cube_face_count, [&](size_t face_begin, size_t face_end) {
+		for (size_t face_index = face_begin; face_index < face_end; face_index++) {
+			const CubeFace& face = cubeSphereFace(face_index);
+			vertex* face_vertex = vertex_buf.data() + face_index * face_vertices;
+
+			for (GLuint row = 0; row <= n; row++) {
+				for (GLuint column = 0; column <= n; column++) {
+					const glm::vec3 cube_position =
+						face.normal + face.right * warp[column] + face.up * warp[row];
+					face_vertex[row * face_side + column] =
+						sphereVertex(glm::normalize(cube_position));
+				}
+			}
+
+			const int base = static_cast<int>(face_index * face_vertices);
+			glm::ivec3* triangle = indices.data() + face_index * face_triangles;
+			for (GLuint row = 0; row < n; row++) {
+				for (GLuint column = 0; column < n; column++) {
+					const int p0 = base + static_cast<int>(row * face_side + column);
+					const int p1 = p0 + 1;
+					const int p2 = p1 + static_cast<int>(face_side);
+					const int p3 = p0 + static_cast<int>(face_side);
+
+					// Divide o quad pela diagonal mais curta; perto dos cantos
+					// do cubo as celulas viram losangos.
+					const float diagonal_02 = glm::distance(
+						vertex_buf[p0].position, vertex_buf[p2].position);
+					const float diagonal_13 = glm::distance(
+						vertex_buf[p1].position, vertex_buf[p3].position);
+
+					if (diagonal_13 <= diagonal_02) {
+						*triangle++ = glm::ivec3{ p0, p1, p3 };
+						*triangle++ = glm::ivec3{ p3, p1, p2 };
+					} else {
+						*triangle++ = glm::ivec3{ p0, p1, p2 };
+						*triangle++ = glm::ivec3{ p0, p2, p3 };
+					}
+				}
+			}
+		}
+	});
+
+	assignSphericalUVs(vertex_buf, indices);
+
+	if (reports) {
+		reportGeneration(sphereTopologyName(SphereTopology::CubeSphere), resolution,
+			vertex_buf.size(), indices.size(), start_time);
+	}
+}
+
+void generateSphere(SphereTopology topology,
+					GLuint uv_resolution,
+					std::vector<vertex>& vertex_buf,
+					std::vector<glm::ivec3>& indices,
+					bool reports
+					) {
+	const GLuint resolution = sphereResolutionFor(topology, uv_resolution);
+
+	switch (topology) {
+	case SphereTopology::UVSphere:
+		generateSphereMesh(resolution, vertex_buf, indices, reports);
+		break;
+	case SphereTopology::Icosphere:
+		generateIcosphereMesh(resolution, vertex_buf, indices, reports);
+		break;
+	case SphereTopology::CubeSphere:
+		generateCubeSphereMesh(resolution, vertex_buf, indices, reports);
+		break;
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// Incrementar quando a saida de algum gerador, do otimizador ou da divisao em
+// blocos mudar; invalida o cache de malhas (mesh_cache.h).
+constexpr std::uint32_t sphere_mesh_version = 1;
+
+struct vertex {
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec3 color;
+	glm::vec2 uv;
+};
+
+enum class SphereTopology {
+	UVSphere,
+	Icosphere,
+	CubeSphere
+};
+
+// Faces do cubo usadas pela cube sphere e pelo LOD do globo; right x up
+// aponta para fora (normal).
+struct CubeFace {
+	glm::vec3 normal;
+	glm::vec3 right;
+	glm::vec3 up;
+};
+
+constexpr size_t cube_face_count = 6;
+
+const CubeFace& cubeSphereFace(size_t face);
+
+// Distorcao por tangente de [-1, 1] para o plano da face, exata em +-1.
+float cubeSphereWarp(float s);
+glm::vec3 cubeToSphere(size_t face, const glm::vec2& s);
+
+const char* sphereTopologyName(SphereTopology topology);
+bool parseSphereTopology(const std::string& name, SphereTopology& topology);
+
+// Converte a resolucao da grade UV na resolucao de cada topologia que
+// produz a mesma aresta maxima (mesmo erro em tela) no equador.
+GLuint sphereResolutionFor(SphereTopology topology, GLuint uv_resolution);
+
+size_t sphereMeshVertexCount(GLuint resolution);
+size_t sphereMeshTriangleCount(GLuint resolution);
+
+// Recebe uma linha da grade UV ja calculada: count vertices a partir do
+// indice first_vertex. Chamado em paralelo, com linhas distintas.
+using SphereRowWriter =
+	std::function<void(size_t first_vertex, const vertex* row, size_t count)>;
+
+// Os geradores imprimem tempo e contagens quando reports e verdadeiro.
+
+// Gera a grade UV sem vetores intermediarios: os vertices saem linha a linha
+// por write_row e os indices (3 por triangulo, sphereMeshTriangleCount) sao
+// escritos direto em index_data, que pode ser um buffer GL mapeado.
+void generateSphereMesh(GLuint resolution,
+					const SphereRowWriter& write_row,
+					GLuint* index_data,
+					bool reports = true
+					);
+
+void generateSphereMesh(GLuint resolution,
+					std::vector<vertex>& vertex_buf,
+					std::vector<glm::ivec3>& indices,
+					bool reports = true
+					);
+
+// frequency = numero de segmentos em cada aresta do icosaedro.
+void generateIcosphereMesh(GLuint frequency,
+					std::vector<vertex>& vertex_buf,
+					std::vector<glm::ivec3>& indices,
+					bool reports = true
+					);
+
+// resolution = numero de segmentos em cada aresta de uma face do cubo.
+void generateCubeSphereMesh(GLuint resolution,
+					std::vector<vertex>& vertex_buf,
+					std::vector<glm::ivec3>& indices,
+					bool reports = true
+					);
+
+void generateSphere(SphereTopology topology,
+					GLuint uv_resolution,
+					std::vector<vertex>& vertex_buf,
+					std::vector<glm::ivec3>& indices,
+					bool reports = true
+					);
@@ -0,0 +1,136 @@
+#include "sphere_pipeline.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "mesh_optimizer.h"
+
+namespace {
+
+template <typename T>
+void releaseVector(std::vector<T>& values) {
+	std::vector<T>().swap(values);
+}
+
+// Sem parallelFor: chamado de dentro das threads do gerador.
+void encodeRow(VertexFormat format, const vertex* row, size_t count,
+			   unsigned char* destination) {
+	switch (format) {
+	case VertexFormat::Full:
+		std::memcpy(destination, row, count * sizeof(vertex));
+		break;
+	case VertexFormat::Packed: {
+		packedVertex* packed = reinterpret_cast<packedVertex*>(destination);
+		for (size_t index = 0; index < count; index++) {
+			packed[index] = packVertex(row[index]);
+		}
+		break;
+	}
+	}
+}
+
+void streamSphereMesh(const SphereMeshDesc& desc, MeshSink& sink,
+					  SphereMeshLayout& layout, bool reports) {
+	const GLuint resolution = desc.resolution;
+	const size_t stride = vertexFormatStride(desc.vertex_format);
+	const size_t num_vertices = sphereMeshVertexCount(resolution);
+	const size_t num_indices = sphereMeshTriangleCount(resolution) * 3;
+
+	unsigned char* vertex_data = static_cast<unsigned char*>(
+		sink.vertices(num_vertices * stride));
+	GLuint* index_data = static_cast<GLuint*>(
+		sink.indices(num_indices * sizeof(GLuint)));
+
+	const VertexFormat format = desc.vertex_format;
+	generateSphereMesh(resolution,
+		[format, stride, vertex_data](size_t first_vertex, const vertex* row, size_t count) {
+			encodeRow(format, row, count, vertex_data + first_vertex * stride);
+		},
+		index_data,
+		reports
+	);
+
+	MeshChunk chunk;
+	chunk.index_count = static_cast<GLsizei>(num_indices);
+
+	layout.chunks.assign(1, chunk);
+	layout.primitive = GL_TRIANGLES;
+	layout.index_type = GL_UNSIGNED_INT;
+	layout.num_vertices = static_cast<GLuint>(num_vertices);
+	layout.num_indices = static_cast<GLuint>(num_indices);
+}
+
+}
+
+void buildSphereMesh(const SphereMeshDesc& desc, MeshSink& sink,
+					SphereMeshLayout& layout, bool reports) {
+	if (desc.topology == SphereTopology::UVSphere && !desc.optimize &&
+		desc.index_format == IndexFormat::Triangles32) {
+		streamSphereMesh(desc, sink, layout, reports);
+		sink.finish();
+		return;
+	}
+
+	// O otimizador e os blocos precisam da malha inteira em memoria; a saida
+	// deles vai direto para o sink, e cada vetor e solto assim que deixa de
+	// ser necessario.
+	std::vector<vertex> vertices;
+	std::vector<glm::ivec3> triangles;
+	generateSphere(desc.topology, desc.resolution, vertices, triangles, reports);
+
+	if (desc.optimize) {
+		optimizeMesh(vertices, triangles, reports);
+	}
+
+	const size_t stride = vertexFormatStride(desc.vertex_format);
+	layout.chunks.clear();
+
+	if (desc.index_format == IndexFormat::Triangles32) {
+		MeshChunk chunk;
+		chunk.index_count = static_cast<GLsizei>(triangles.size() * 3);
+		layout.chunks.push_back(chunk);
+
+		layout.primitive = GL_TRIANGLES;
+		layout.index_type = GL_UNSIGNED_INT;
+		layout.num_indices = static_cast<GLuint>(triangles.size() * 3);
+		layout.num_vertices = static_cast<GLuint>(vertices.size());
+
+		const size_t index_bytes = triangles.size() * sizeof(glm::ivec3);
+		std::memcpy(sink.indices(index_bytes), triangles.data(), index_bytes);
+		releaseVector(triangles);
+
+		encodeVertices(desc.vertex_format, vertices.data(), vertices.size(),
+			sink.vertices(vertices.size() * stride));
+	} else {
+		ChunkedMesh chunked;
+		buildChunkedMesh(vertices.size(), triangles,
+			desc.index_format == IndexFormat::Strips16, chunked, reports);
+		releaseVector(triangles);
+
+		layout.primitive = chunked.primitive;
+		layout.index_type = GL_UNSIGNED_SHORT;
+		layout.chunks = chunked.chunks;
+		layout.num_indices = static_cast<GLuint>(chunked.indices.size());
+		layout.num_vertices = static_cast<GLuint>(chunked.vertex_remap.size());
+
+		const size_t index_bytes = chunked.indices.size() * sizeof(std::uint16_t);
+		std::memcpy(sink.indices(index_bytes), chunked.indices.data(), index_bytes);
+		releaseVector(chunked.indices);
+
+		// Os duplicados entre blocos sao codificados a partir da malha
+		// original, sem uma copia intermediaria dos vertices.
+		encodeVertices(desc.vertex_format, vertices.data(), chunked.vertex_remap.data(),
+			chunked.vertex_remap.size(), sink.vertices(chunked.vertex_remap.size() * stride));
+	}
+
+	sink.finish();
+}
+
+void buildSphereMeshData(const SphereMeshDesc& desc, SphereMeshData& data,
+					bool reports) {
+	MemoryMeshSink sink;
+	buildSphereMesh(desc, sink, data, reports);
+
+	data.vertex_data.swap(sink.vertex_data);
+	data.index_data.swap(sink.index_data);
+}
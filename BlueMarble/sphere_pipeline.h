@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "mesh_chunks.h"
+#include "mesh_sink.h"
+#include "sphere_mesh.h"
+#include "vertex_format.h"
+
+// Parametros que determinam completamente a malha enviada ao GL.
+struct SphereMeshDesc {
+	SphereTopology topology = SphereTopology::UVSphere;
+	// Resolucao equivalente da grade UV (ver sphereResolutionFor).
+	GLuint resolution = 50;
+	VertexFormat vertex_format = VertexFormat::Packed;
+	IndexFormat index_format = IndexFormat::Triangles16;
+	bool optimize = true;
+};
+
+// Como desenhar a malha: blocos, primitiva e tipo dos indices.
+struct SphereMeshLayout {
+	std::vector<MeshChunk> chunks;
+	GLenum primitive = GL_TRIANGLES;
+	GLenum index_type = GL_UNSIGNED_INT;
+	GLuint num_vertices = 0;
+	GLuint num_indices = 0;
+};
+
+// Malha pronta para upload: vertices ja codificados no formato pedido e
+// indices de 16 ou 32 bits com a lista de blocos de desenho.
+struct SphereMeshData : SphereMeshLayout {
+	std::vector<unsigned char> vertex_data;
+	std::vector<unsigned char> index_data;
+};
+
+// Referencia os bytes de uma malha sem copia-los (arquivo de cache mapeado).
+struct SphereMeshView : SphereMeshLayout {
+	const void* vertex_data = nullptr;
+	size_t vertex_bytes = 0;
+	const void* index_data = nullptr;
+	size_t index_bytes = 0;
+};
+
+// Gera, otimiza, divide em blocos e codifica a malha descrita, escrevendo os
+// bytes finais em sink. A grade UV sem otimizacao e com indices de 32 bits
+// e gerada direto no sink, sem nenhuma copia intermediaria; nos outros casos
+// so a malha de trabalho do otimizador fica em memoria e os vertices sao
+// codificados direto no sink. reports liga os relatorios de cada etapa.
+void buildSphereMesh(const SphereMeshDesc& desc, MeshSink& sink,
+					SphereMeshLayout& layout, bool reports = true);
+
+void buildSphereMeshData(const SphereMeshDesc& desc, SphereMeshData& data,
+					bool reports = true);
+
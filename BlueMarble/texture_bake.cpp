@@ -0,0 +1,235 @@
+#include "texture_bake.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+#include <stb_image.h>
+
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include <stb_image_resize.h>
+
+#include "parallel.h"
+#include "texture_compression.h"
+#include "virtual_texture_file.h"
+
+namespace {
+
+// O nivel mais fino de uma piramide .bmvt que cabe em max_size, decodificado
+// tile a tile em paralelo direto no buffer do nivel. A piramide ja tem os
+// niveis menores, entao o nivel 0 de um mosaico enorme nunca e decodificado.
+bool loadTiledLevel(const std::string& source_file, int channels, int max_size,
+					TextureLevel& level) {
+	VirtualTextureFile tiled;
+	if (!tiled.open(source_file)) {
+		return false;
+	}
+
+	size_t index = 0;
+	while (max_size > 0 && index + 1 < tiled.levelCount() &&
+		(tiled.level(index).width > static_cast<std::uint32_t>(max_size) ||
+		 tiled.level(index).height > static_cast<std::uint32_t>(max_size))) {
+		index++;
+	}
+
+	if (index > 0) {
+		std::cout << "Piramide maior que o limite de " << max_size << ", usando o nivel "
+			<< index << " - " << source_file << std::endl;
+	}
+
+	level.width = static_cast<int>(tiled.level(index).width);
+	level.height = static_cast<int>(tiled.level(index).height);
+	level.data.resize(static_cast<size_t>(level.width) * level.height * channels);
+
+	return decodeVirtualTextureLevel(tiled, index, channels, level.data.data());
+}
+
+bool isTiledSource(const std::string& source_file) {
+	return source_file.size() > 5 &&
+		source_file.compare(source_file.size() - 5, 5, ".bmvt") == 0;
+}
+
+}
+
+void buildMipChain(std::vector<TextureLevel>& levels, int channels, bool periodic) {
+	const int alpha_channel = channels == 4 ? 3 : STBIR_ALPHA_CHANNEL_NONE;
+	const stbir_edge horizontal_edge = periodic ? STBIR_EDGE_WRAP : STBIR_EDGE_CLAMP;
+
+	while (levels.back().width > 1 || levels.back().height > 1) {
+		const TextureLevel& source = levels.back();
+
+		TextureLevel level;
+		level.width = std::max(1, source.width / 2);
+		level.height = std::max(1, source.height / 2);
+		level.data.resize(static_cast<size_t>(level.width) * level.height * channels);
+
+		const size_t row_bytes = static_cast<size_t>(level.width) * channels;
+		const float inv_height = 1.0f / static_cast<float>(level.height);
+
+		// Cada faixa e um resize da regiao correspondente da origem; o
+		// filtro ainda le as linhas vizinhas, entao as faixas emendam sem
+		// costura.
+		parallelFor(0, level.height, [&](size_t row_begin, size_t row_end) {
+			stbir_resize_region(source.data.data(), source.width, source.height,
+				source.width * channels,
+				level.data.data() + row_begin * row_bytes, level.width,
+				static_cast<int>(row_end - row_begin), static_cast<int>(row_bytes),
+				STBIR_TYPE_UINT8, channels, alpha_channel, 0,
+				horizontal_edge, STBIR_EDGE_CLAMP,
+				STBIR_FILTER_MITCHELL, STBIR_FILTER_MITCHELL,
+				STBIR_COLORSPACE_SRGB, nullptr,
+				0.0f, row_begin * inv_height, 1.0f, row_end * inv_height);
+		}, 32);
+
+		levels.push_back(std::move(level));
+	}
+}
+
+bool bakeTexture(const std::string& source_file, bool compress, TextureChain& chain,
+					int max_size) {
+	const auto start_time = std::chrono::steady_clock::now();
+
+	chain.levels.clear();
+	chain.levels.emplace_back();
+
+	int channels = 0;
+
+	if (isTiledSource(source_file)) {
+		// Os tiles sao JPEG, sem alpha.
+		channels = compress ? 4 : 3;
+		if (!loadTiledLevel(source_file, channels, max_size, chain.levels[0])) {
+			chain.levels.clear();
+			return false;
+		}
+	} else {
+		int width = 0;
+		int height = 0;
+		int number_of_components = 0;
+		if (!stbi_info(source_file.c_str(), &width, &height, &number_of_components)) {
+			chain.levels.clear();
+			return false;
+		}
+
+		// stb_dxt sempre le RGBA; sem compressao o alpha so e mantido se existir.
+		channels = compress || number_of_components == 4 ? 4 : 3;
+
+		unsigned char* pixels = stbi_load(source_file.c_str(), &width, &height,
+			&number_of_components, channels);
+		if (!pixels) {
+			chain.levels.clear();
+			return false;
+		}
+
+		chain.levels[0].width = width;
+		chain.levels[0].height = height;
+		chain.levels[0].data.assign(pixels,
+			pixels + static_cast<size_t>(width) * height * channels);
+		stbi_image_free(pixels);
+	}
+
+	buildMipChain(chain.levels, channels);
+
+	if (limitTextureChain(chain, max_size) > 0) {
+		std::cout << "Imagem maior que o limite de " << max_size
+			<< ", niveis de cima descartados - " << source_file << std::endl;
+	}
+
+	const int width = chain.levels[0].width;
+	const int height = chain.levels[0].height;
+
+	chain.internal_format = channels == 4 ? GL_RGBA8 : GL_RGB8;
+	chain.format = channels == 4 ? GL_RGBA : GL_RGB;
+	chain.type = GL_UNSIGNED_BYTE;
+
+	if (compress) {
+		compressChain(chain);
+	}
+
+	const std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - start_time;
+	std::cout << "Textura preparada - " << source_file << " (" << width << "x"
+		<< height << ", " << chain.levels.size() << " niveis, "
+		<< chain.byteSize() / 1024 << " KB em " << elapsed.count() * 1000.0
+		<< " ms)" << std::endl;
+
+	return true;
+}
+
+bool bakeTextureLike(const std::string& source_file, const TextureChainView& like,
+					TextureChain& chain) {
+	const auto start_time = std::chrono::steady_clock::now();
+
+	const int width = like.levels[0].width;
+	const int height = like.levels[0].height;
+
+	int source_width = 0;
+	int source_height = 0;
+	int number_of_components = 0;
+	unsigned char* pixels = stbi_load(source_file.c_str(), &source_width, &source_height,
+		&number_of_components, 4);
+	if (!pixels) {
+		chain.levels.clear();
+		return false;
+	}
+
+	std::vector<TextureLevel> levels(1);
+	levels[0].width = width;
+	levels[0].height = height;
+	levels[0].data.resize(static_cast<size_t>(width) * height * 4);
+
+	stbir_resize(pixels, source_width, source_height, source_width * 4,
+		levels[0].data.data(), width, height, width * 4,
+		STBIR_TYPE_UINT8, 4, 3, 0,
+		STBIR_EDGE_WRAP, STBIR_EDGE_CLAMP,
+		STBIR_FILTER_MITCHELL, STBIR_FILTER_MITCHELL,
+		STBIR_COLORSPACE_SRGB, nullptr);
+	stbi_image_free(pixels);
+
+	buildMipChain(levels, 4);
+
+	chain.levels.clear();
+	chain.internal_format = like.internal_format;
+	chain.format = like.format;
+	chain.type = like.type;
+
+	for (TextureLevel& level : levels) {
+		TextureLevel converted;
+		if (like.compressed()) {
+			const BlockFormat format =
+				like.internal_format == blockFormatInternalFormat(BlockFormat::BC3) ?
+				BlockFormat::BC3 : BlockFormat::BC1;
+			compressLevel(level, format, converted);
+		} else if (like.format == GL_RGB) {
+			converted.width = level.width;
+			converted.height = level.height;
+			converted.data.resize(level.data.size() / 4 * 3);
+			for (size_t texel = 0; texel < level.data.size() / 4; texel++) {
+				std::copy_n(level.data.begin() + texel * 4, 3, converted.data.begin() + texel * 3);
+			}
+		} else {
+			converted = std::move(level);
+		}
+		chain.levels.push_back(std::move(converted));
+	}
+
+	const std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - start_time;
+	std::cout << "Textura preparada no formato de outra camada - " << source_file << " ("
+		<< source_width << "x" << source_height << " -> " << width << "x" << height << ", "
+		<< chain.byteSize() / 1024 << " KB em " << elapsed.count() * 1000.0
+		<< " ms)" << std::endl;
+
+	return true;
+}
+
+bool bakeTextureContainer(const std::string& source_file, bool compress, int max_size) {
+	TextureChain chain;
+	if (!bakeTexture(source_file, compress, chain, max_size)) {
+		std::cout << "Erro ao ler textura - " << source_file << std::endl;
+		return false;
+	}
+
+	return storeTextureContainer(textureContainerPath(source_file, compress),
+		source_file, chain);
+}
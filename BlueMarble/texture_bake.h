@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "texture_container.h"
+
+// Gera os niveis 1..n a partir de levels[0] (channels bytes por texel) com
+// stb_image_resize: filtro Mitchell em espaco linear (sRGB), costura
+// horizontal periodica (ou bordas repetidas, com periodic false, para faces
+// de cubemap) e cada nivel dividido em faixas de linhas entre as threads.
+void buildMipChain(std::vector<TextureLevel>& levels, int channels, bool periodic = true);
+
+// Lado maximo usado pelo bake offline (--bake-textures), sem contexto GL para
+// consultar GL_MAX_TEXTURE_SIZE; e o limite das GPUs atuais, e o carregador
+// ainda corta os niveis acima do limite real.
+constexpr int bake_max_texture_size = 16384;
+
+// Decodifica source_file, gera a cadeia de mips e, se compress, comprime em
+// BC1/BC3. O nivel 0 tem no maximo max_size texels de lado (0 nao limita).
+// De uma piramide .bmvt (virtual_texture_file.h) so o nivel mais fino que
+// cabe e decodificado, tile a tile em paralelo; o resto da piramide nem e
+// lido. De uma imagem comum maior que o limite os niveis de cima sao
+// descartados. Retorna false se a imagem nao puder ser lida.
+bool bakeTexture(const std::string& source_file, bool compress, TextureChain& chain,
+					int max_size = 0);
+
+// Prepara source_file com o tamanho, o formato e os niveis de like, para
+// uma camada de textura array: RGBA redimensionado em espaco linear, mips e
+// depois o mesmo bloco BC de like ou o alpha descartado. Retorna false se a
+// imagem nao puder ser lida.
+bool bakeTextureLike(const std::string& source_file, const TextureChainView& like,
+					TextureChain& chain);
+
+// bakeTexture + storeTextureContainer em textureContainerPath.
+bool bakeTextureContainer(const std::string& source_file, bool compress,
+					int max_size = bake_max_texture_size);
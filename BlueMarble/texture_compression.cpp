@@ -0,0 +1,94 @@
+#include "texture_compression.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <mutex>
+
+#define STB_DXT_IMPLEMENTATION
+#include <stb_dxt.h>
+
+#include "parallel.h"
+
+GLenum blockFormatInternalFormat(BlockFormat format) {
+	switch (format) {
+	case BlockFormat::BC1:
+		return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case BlockFormat::BC3:
+		return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	}
+	return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+}
+
+size_t blockFormatBlockSize(BlockFormat format) {
+	return format == BlockFormat::BC3 ? 16 : 8;
+}
+
+BlockFormat chooseBlockFormat(const TextureLevel& rgba) {
+	for (size_t index = 3; index < rgba.data.size(); index += 4) {
+		if (rgba.data[index] != 255) {
+			return BlockFormat::BC3;
+		}
+	}
+	return BlockFormat::BC1;
+}
+
+void compressLevel(const TextureLevel& rgba, BlockFormat format,
+					TextureLevel& compressed) {
+	// stb_dxt monta suas tabelas no primeiro bloco sem sincronizacao;
+	// comprime um bloco aqui antes de abrir as threads.
+	static std::once_flag dxt_tables;
+	std::call_once(dxt_tables, []() {
+		unsigned char block[16 * 4] = {};
+		unsigned char output[16];
+		stb_compress_dxt_block(output, block, 1, STB_DXT_NORMAL);
+	});
+
+	const int width = rgba.width;
+	const int height = rgba.height;
+	const int blocks_x = (width + 3) / 4;
+	const int blocks_y = (height + 3) / 4;
+	const size_t block_size = blockFormatBlockSize(format);
+	const int alpha = format == BlockFormat::BC3 ? 1 : 0;
+	const unsigned char* pixels = rgba.data.data();
+
+	compressed.width = width;
+	compressed.height = height;
+	compressed.data.resize(static_cast<size_t>(blocks_x) * blocks_y * block_size);
+
+	parallelFor(0, blocks_y, [&](size_t block_row_begin, size_t block_row_end) {
+		unsigned char block[16 * 4];
+
+		for (size_t block_y = block_row_begin; block_y < block_row_end; block_y++) {
+			for (int block_x = 0; block_x < blocks_x; block_x++) {
+				// Blocos na borda de niveis pequenos repetem o ultimo pixel.
+				for (int texel = 0; texel < 16; texel++) {
+					const int x = std::min(block_x * 4 + (texel & 3), width - 1);
+					const int y = std::min(static_cast<int>(block_y) * 4 + (texel >> 2), height - 1);
+					std::memcpy(block + texel * 4,
+						pixels + (static_cast<size_t>(y) * width + x) * 4, 4);
+				}
+
+				unsigned char* destination = compressed.data.data() +
+					(block_y * blocks_x + block_x) * block_size;
+				stb_compress_dxt_block(destination, block, alpha, STB_DXT_HIGHQUAL);
+			}
+		}
+	}, 4);
+}
+
+void compressChain(TextureChain& chain) {
+	assert(chain.format == GL_RGBA && chain.type == GL_UNSIGNED_BYTE);
+
+	const BlockFormat format = chooseBlockFormat(chain.levels[0]);
+
+	for (TextureLevel& level : chain.levels) {
+		TextureLevel compressed;
+		compressLevel(level, format, compressed);
+		level = std::move(compressed);
+	}
+
+	chain.internal_format = blockFormatInternalFormat(format);
+	chain.format = 0;
+	chain.type = 0;
+}
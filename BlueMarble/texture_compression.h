@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+#include <GL/glew.h>
+
+#include "texture_container.h"
+
+// Compressao em blocos 4x4 (S3TC) com stb_dxt: BC1 (8 bytes por bloco) para
+// imagens opacas e BC3 (16 bytes) quando ha alpha.
+enum class BlockFormat {
+	BC1,
+	BC3
+};
+
+GLenum blockFormatInternalFormat(BlockFormat format);
+size_t blockFormatBlockSize(BlockFormat format);
+
+// BC3 se algum texel de um nivel RGBA nao for opaco.
+BlockFormat chooseBlockFormat(const TextureLevel& rgba);
+
+// Comprime um nivel RGBA com os blocos divididos entre as threads.
+void compressLevel(const TextureLevel& rgba, BlockFormat format,
+					TextureLevel& compressed);
+
+// Troca cada nivel RGBA da cadeia pela sua versao comprimida.
+void compressChain(TextureChain& chain);
@@ -0,0 +1,227 @@
+#include "texture_container.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+constexpr char texture_container_magic[12] = {
+	'\xAB', 'B', 'M', 'T', 'X', ' ', '1', '\xBB', '\r', '\n', '\x1A', '\n' };
+constexpr std::uint32_t texture_container_version = 2;
+
+struct textureContainerHeader {
+	char magic[12];
+	std::uint32_t version;
+	std::uint32_t internal_format;
+	std::uint32_t format;
+	std::uint32_t type;
+	std::uint32_t width;
+	std::uint32_t height;
+	std::uint32_t level_count;
+	std::uint64_t source_size;
+	std::int64_t source_time;
+};
+
+// Niveis alinhados a 4 bytes, como no KTX.
+size_t levelPadding(size_t size) {
+	return (4 - size % 4) % 4;
+}
+
+template <typename Levels>
+size_t dropOversizedLevels(Levels& levels, int max_size) {
+	size_t dropped = 0;
+	if (max_size > 0) {
+		while (dropped + 1 < levels.size() &&
+			(levels[dropped].width > max_size || levels[dropped].height > max_size)) {
+			dropped++;
+		}
+		levels.erase(levels.begin(), levels.begin() + dropped);
+	}
+	return dropped;
+}
+
+}
+
+size_t TextureChain::byteSize() const {
+	size_t size = 0;
+	for (const TextureLevel& level : levels) {
+		size += level.data.size();
+	}
+	return size;
+}
+
+size_t TextureChainView::byteSize() const {
+	size_t size = 0;
+	for (const TextureLevelView& level : levels) {
+		size += level.size;
+	}
+	return size;
+}
+
+size_t limitTextureChain(TextureChain& chain, int max_size) {
+	return dropOversizedLevels(chain.levels, max_size);
+}
+
+size_t limitTextureChain(TextureChainView& view, int max_size) {
+	return dropOversizedLevels(view.levels, max_size);
+}
+
+TextureChainView textureChainView(const TextureChain& chain) {
+	TextureChainView view;
+	view.internal_format = chain.internal_format;
+	view.format = chain.format;
+	view.type = chain.type;
+
+	for (const TextureLevel& level : chain.levels) {
+		TextureLevelView level_view;
+		level_view.width = level.width;
+		level_view.height = level.height;
+		level_view.data = level.data.data();
+		level_view.size = level.data.size();
+		view.levels.push_back(level_view);
+	}
+
+	return view;
+}
+
+bool textureSourceStamp(const std::string& source_file, TextureSourceStamp& stamp) {
+	std::error_code error;
+	stamp.size = std::filesystem::file_size(source_file, error);
+	if (error) {
+		return false;
+	}
+	stamp.time = static_cast<std::int64_t>(
+		std::filesystem::last_write_time(source_file, error).time_since_epoch().count());
+	return !error;
+}
+
+std::string textureContainerPath(const std::string& source_file, bool compressed,
+					const std::string& directory) {
+	return directory + "/" + std::filesystem::path(source_file).stem().string() +
+		(compressed ? "_bc" : "_rgb") + ".bmtx";
+}
+
+bool mapTextureContainer(const std::string& path, const std::string& source_file,
+					MappedFile& file, TextureChainView& view) {
+	if (!file.open(path)) {
+		return false;
+	}
+
+	textureContainerHeader header;
+	if (file.size() < sizeof(header)) {
+		std::cout << "Container de textura invalido - " << path << std::endl;
+		file.close();
+		return false;
+	}
+	std::memcpy(&header, file.data(), sizeof(header));
+
+	if (std::memcmp(header.magic, texture_container_magic, sizeof(header.magic)) != 0 ||
+		header.version != texture_container_version || header.level_count == 0) {
+		std::cout << "Container de textura invalido - " << path << std::endl;
+		file.close();
+		return false;
+	}
+
+	TextureSourceStamp stamp;
+	if (textureSourceStamp(source_file, stamp) &&
+		(stamp.size != header.source_size || stamp.time != header.source_time)) {
+		std::cout << "Container de textura desatualizado - " << path << std::endl;
+		file.close();
+		return false;
+	}
+
+	view.internal_format = header.internal_format;
+	view.format = header.format;
+	view.type = header.type;
+	view.levels.resize(header.level_count);
+
+	int width = static_cast<int>(header.width);
+	int height = static_cast<int>(header.height);
+	size_t offset = sizeof(header);
+
+	for (TextureLevelView& level : view.levels) {
+		std::uint64_t image_size = 0;
+		if (offset + sizeof(image_size) > file.size()) {
+			std::cout << "Container de textura truncado - " << path << std::endl;
+			file.close();
+			return false;
+		}
+		std::memcpy(&image_size, file.data() + offset, sizeof(image_size));
+		offset += sizeof(image_size);
+
+		if (image_size > file.size() - offset) {
+			std::cout << "Container de textura truncado - " << path << std::endl;
+			file.close();
+			return false;
+		}
+
+		level.width = width;
+		level.height = height;
+		level.data = file.data() + offset;
+		level.size = static_cast<size_t>(image_size);
+
+		offset += level.size + levelPadding(level.size);
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+
+	return true;
+}
+
+bool storeTextureContainer(const std::string& path, const std::string& source_file,
+					const TextureChain& chain) {
+	// Sem o carimbo da origem o container nunca seria invalidado.
+	TextureSourceStamp stamp;
+	if (!textureSourceStamp(source_file, stamp)) {
+		std::cout << "Origem sem data ou tamanho, container nao gravado - "
+			<< source_file << std::endl;
+		return false;
+	}
+
+	textureContainerHeader header{};
+	std::memcpy(header.magic, texture_container_magic, sizeof(header.magic));
+	header.version = texture_container_version;
+	header.internal_format = chain.internal_format;
+	header.format = chain.format;
+	header.type = chain.type;
+	header.width = static_cast<std::uint32_t>(chain.levels[0].width);
+	header.height = static_cast<std::uint32_t>(chain.levels[0].height);
+	header.level_count = static_cast<std::uint32_t>(chain.levels.size());
+	header.source_size = stamp.size;
+	header.source_time = stamp.time;
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+	const std::string temporary_path = path + ".tmp";
+
+	{
+		std::ofstream stream{ temporary_path, std::ios::binary | std::ios::trunc };
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		const char padding[4] = {};
+		for (const TextureLevel& level : chain.levels) {
+			const std::uint64_t image_size = level.data.size();
+			stream.write(reinterpret_cast<const char*>(&image_size), sizeof(image_size));
+			stream.write(reinterpret_cast<const char*>(level.data.data()),
+				static_cast<std::streamsize>(level.data.size()));
+			stream.write(padding, levelPadding(level.data.size()));
+		}
+
+		if (!stream) {
+			std::cout << "Erro ao gravar container de textura - " << path << std::endl;
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temporary_path, path, error);
+	if (error) {
+		std::filesystem::remove(path, error);
+		std::filesystem::rename(temporary_path, path, error);
+	}
+
+	return !error;
+}
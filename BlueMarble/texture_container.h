@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "mapped_file.h"
+
+// Container de textura no espirito do KTX 1: um cabecalho com os enums GL e
+// os niveis de mip em sequencia, cada um precedido do seu tamanho em bytes
+// (64 bits: um nivel RGBA acima de 32768x32768 passa de 4 GB). O carregador
+// envia nivel por nivel sem decodificar nem chamar glGenerateMipmap.
+
+struct TextureLevel {
+	int width = 0;
+	int height = 0;
+	std::vector<unsigned char> data;
+};
+
+struct TextureChain {
+	GLenum internal_format = GL_RGB8;
+	// Como no KTX, format e type sao 0 em texturas comprimidas.
+	GLenum format = GL_RGB;
+	GLenum type = GL_UNSIGNED_BYTE;
+	// Nivel 0 primeiro, ate 1x1.
+	std::vector<TextureLevel> levels;
+
+	bool compressed() const { return type == 0; }
+	size_t byteSize() const;
+};
+
+// Mesma cadeia apontando para memoria de outro dono: o container mapeado ou
+// uma TextureChain, que precisam viver enquanto a view for usada.
+struct TextureLevelView {
+	int width = 0;
+	int height = 0;
+	const unsigned char* data = nullptr;
+	size_t size = 0;
+};
+
+struct TextureChainView {
+	GLenum internal_format = GL_RGB8;
+	GLenum format = GL_RGB;
+	GLenum type = GL_UNSIGNED_BYTE;
+	std::vector<TextureLevelView> levels;
+
+	bool compressed() const { return type == 0; }
+	size_t byteSize() const;
+};
+
+TextureChainView textureChainView(const TextureChain& chain);
+
+// Tira do inicio os niveis com largura ou altura acima de max_size
+// (GL_MAX_TEXTURE_SIZE); 0 nao limita. Devolve quantos niveis sairam.
+size_t limitTextureChain(TextureChain& chain, int max_size);
+size_t limitTextureChain(TextureChainView& view, int max_size);
+
+// Tamanho e data de modificacao do arquivo de origem; um container gravado
+// com outro carimbo esta desatualizado.
+struct TextureSourceStamp {
+	std::uint64_t size = 0;
+	std::int64_t time = 0;
+};
+
+bool textureSourceStamp(const std::string& source_file, TextureSourceStamp& stamp);
+
+// cache/<nome>_bc.bmtx ou cache/<nome>_rgb.bmtx.
+std::string textureContainerPath(const std::string& source_file, bool compressed,
+					const std::string& directory = "cache");
+
+// Mapeia o container e aponta a view para os niveis dentro do mapeamento,
+// sem copiar nada; file precisa continuar aberto enquanto a view for usada.
+// Se o arquivo de origem existir, o carimbo gravado precisa bater com ele;
+// sem origem (so o container foi distribuido) o container e aceito.
+bool mapTextureContainer(const std::string& path, const std::string& source_file,
+					MappedFile& file, TextureChainView& view);
+
+// Falha sem gravar nada se o carimbo de source_file nao puder ser lido.
+bool storeTextureContainer(const std::string& path, const std::string& source_file,
+					const TextureChain& chain);
@@ -0,0 +1,233 @@
+#include "texture_cubemap.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <stb_image.h>
+
+#include "parallel.h"
+#include "texture_bake.h"
+#include "texture_compression.h"
+
+namespace {
+
+struct equirectangularImage {
+	int width;
+	int height;
+	int channels;
+	const unsigned char* pixels;
+};
+
+// Byte sRGB -> linear em [0, 1], uma entrada por valor.
+struct srgbTable {
+	float linear[256];
+
+	srgbTable() {
+		for (int value = 0; value < 256; value++) {
+			const float c = value / 255.0f;
+			linear[value] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+	}
+};
+
+const srgbTable srgb_table;
+
+unsigned char linearToSrgb(float c) {
+	c = std::clamp(c, 0.0f, 1.0f);
+	const float encoded = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+	return static_cast<unsigned char>(encoded * 255.0f + 0.5f);
+}
+
+// Direcao do texel (s, t) em [0, 1] da face, pela tabela de faces do GL
+// (linha 0 da imagem em t = 0).
+glm::vec3 faceDirection(size_t face, float s, float t) {
+	const float sc = 2.0f * s - 1.0f;
+	const float tc = 2.0f * t - 1.0f;
+
+	switch (face) {
+	case 0: return glm::vec3{ 1.0f, -tc, -sc };
+	case 1: return glm::vec3{ -1.0f, -tc, sc };
+	case 2: return glm::vec3{ sc, 1.0f, tc };
+	case 3: return glm::vec3{ sc, -1.0f, -tc };
+	case 4: return glm::vec3{ sc, -tc, 1.0f };
+	default: return glm::vec3{ -sc, -tc, -1.0f };
+	}
+}
+
+// Bilinear com u periodico e v preso, na convencao de sphericalUV. Soma em
+// color os canais em espaco linear (o alpha, se houver, ja e linear) de 0 a 1.
+void sampleEquirectangular(const equirectangularImage& image, glm::vec3 direction,
+					float* color) {
+	const float pi = 3.14159265f;
+
+	direction = glm::normalize(direction);
+	float u = std::atan2(direction.y, direction.x) / (2.0f * pi);
+	u -= std::floor(u);
+	const float v = std::acos(std::clamp(direction.z, -1.0f, 1.0f)) / pi;
+
+	const float x = u * image.width - 0.5f;
+	const float y = std::clamp(v * image.height - 0.5f, 0.0f, image.height - 1.0f);
+
+	const int x0 = static_cast<int>(std::floor(x));
+	const int y0 = static_cast<int>(y);
+	const float fx = x - x0;
+	const float fy = y - y0;
+
+	const int xa = (x0 % image.width + image.width) % image.width;
+	const int xb = (xa + 1) % image.width;
+	const int ya = y0;
+	const int yb = std::min(y0 + 1, image.height - 1);
+
+	auto texel = [&](int tx, int ty, int channel) {
+		const unsigned char value = image.pixels[
+			(static_cast<size_t>(ty) * image.width + tx) * image.channels + channel];
+		return channel < 3 ? srgb_table.linear[value] : value / 255.0f;
+	};
+
+	for (int channel = 0; channel < image.channels; channel++) {
+		const float top = texel(xa, ya, channel) * (1.0f - fx) + texel(xb, ya, channel) * fx;
+		const float bottom = texel(xa, yb, channel) * (1.0f - fx) + texel(xb, yb, channel) * fx;
+		color[channel] += top * (1.0f - fy) + bottom * fy;
+	}
+}
+
+void reprojectFace(const equirectangularImage& image, size_t face, TextureLevel& level) {
+	const int size = level.width;
+	const int channels = image.channels;
+	const float inv_size = 1.0f / static_cast<float>(size);
+
+	parallelFor(0, static_cast<size_t>(size), [&](size_t row_begin, size_t row_end) {
+		for (size_t row = row_begin; row < row_end; row++) {
+			for (int column = 0; column < size; column++) {
+				float color[4] = {};
+
+				// Perto dos polos muitos texels da origem caem em um so da
+				// face; 2x2 amostras seguram o serrilhado.
+				for (int sample = 0; sample < 4; sample++) {
+					const float s = (column + 0.25f + 0.5f * (sample & 1)) * inv_size;
+					const float t = (row + 0.25f + 0.5f * (sample >> 1)) * inv_size;
+					sampleEquirectangular(image, faceDirection(face, s, t), color);
+				}
+
+				unsigned char* destination = level.data.data() +
+					(row * size + column) * channels;
+				for (int channel = 0; channel < channels; channel++) {
+					const float average = color[channel] * 0.25f;
+					destination[channel] = channel < 3 ? linearToSrgb(average) :
+						static_cast<unsigned char>(std::clamp(average * 255.0f + 0.5f, 0.0f, 255.0f));
+				}
+			}
+		}
+	}, 8);
+}
+
+}
+
+int cubemapFaceSize(int source_width) {
+	const float pi = 3.14159265f;
+	const int size = static_cast<int>(std::lround(source_width / (4.0f * pi))) * 4;
+	return std::max(4, size);
+}
+
+bool bakeCubemap(const std::string& source_file, bool compress, CubemapChains& faces) {
+	const auto start_time = std::chrono::steady_clock::now();
+
+	int width = 0;
+	int height = 0;
+	int number_of_components = 0;
+	if (!stbi_info(source_file.c_str(), &width, &height, &number_of_components)) {
+		return false;
+	}
+
+	// Como em bakeTexture: stb_dxt le RGBA e o alpha so fica se existir.
+	const int channels = compress || number_of_components == 4 ? 4 : 3;
+
+	unsigned char* pixels = stbi_load(source_file.c_str(), &width, &height,
+		&number_of_components, channels);
+	if (!pixels) {
+		return false;
+	}
+
+	const equirectangularImage image{ width, height, channels, pixels };
+	const int face_size = cubemapFaceSize(width);
+
+	for (size_t face = 0; face < cubemap_face_count; face++) {
+		TextureChain& chain = faces[face];
+
+		chain.levels.assign(1, TextureLevel{});
+		chain.levels[0].width = face_size;
+		chain.levels[0].height = face_size;
+		chain.levels[0].data.resize(static_cast<size_t>(face_size) * face_size * channels);
+
+		reprojectFace(image, face, chain.levels[0]);
+		buildMipChain(chain.levels, channels, false);
+
+		chain.internal_format = channels == 4 ? GL_RGBA8 : GL_RGB8;
+		chain.format = channels == 4 ? GL_RGBA : GL_RGB;
+		chain.type = GL_UNSIGNED_BYTE;
+	}
+
+	stbi_image_free(pixels);
+
+	// As seis faces precisam do mesmo formato: BC3 se alguma tiver alpha.
+	if (compress) {
+		BlockFormat format = BlockFormat::BC1;
+		for (const TextureChain& chain : faces) {
+			if (chooseBlockFormat(chain.levels[0]) == BlockFormat::BC3) {
+				format = BlockFormat::BC3;
+			}
+		}
+
+		for (TextureChain& chain : faces) {
+			for (TextureLevel& level : chain.levels) {
+				TextureLevel compressed;
+				compressLevel(level, format, compressed);
+				level = std::move(compressed);
+			}
+			chain.internal_format = blockFormatInternalFormat(format);
+			chain.format = 0;
+			chain.type = 0;
+		}
+	}
+
+	size_t bytes = 0;
+	for (const TextureChain& chain : faces) {
+		bytes += chain.byteSize();
+	}
+
+	const std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - start_time;
+	std::cout << "Cubemap preparado - " << source_file << " (" << width << "x"
+		<< height << " -> 6x" << face_size << "x" << face_size << ", "
+		<< bytes / 1024 << " KB em " << elapsed.count() * 1000.0 << " ms)" << std::endl;
+
+	return true;
+}
+
+std::string cubemapContainerPath(const std::string& source_file, size_t face,
+					bool compressed, const std::string& directory) {
+	return directory + "/" + std::filesystem::path(source_file).stem().string() +
+		"_cube" + std::to_string(face) + (compressed ? "_bc" : "_rgb") + ".bmtx";
+}
+
+bool bakeCubemapContainers(const std::string& source_file, bool compress) {
+	CubemapChains faces;
+	if (!bakeCubemap(source_file, compress, faces)) {
+		std::cout << "Erro ao ler textura - " << source_file << std::endl;
+		return false;
+	}
+
+	for (size_t face = 0; face < cubemap_face_count; face++) {
+		if (!storeTextureContainer(cubemapContainerPath(source_file, face, compress),
+			source_file, faces[face])) {
+			return false;
+		}
+	}
+
+	return true;
+}
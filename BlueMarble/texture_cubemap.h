@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <string>
+
+#include "texture_container.h"
+
+// Reprojecao de uma imagem equiretangular em um cubemap no bake. A imagem
+// equiretangular gasta texels nas linhas polares, que repetem o mesmo punhado
+// de pontos; no cubemap a densidade varia bem menos (o texel do centro da
+// face e ~2.6 vezes o do canto em angulo solido, contra um texel que encolhe
+// ate zero nos polos) e a busca por samplerCube nao tem costura nem polo.
+//
+// O lado da face e largura / pi: no centro da face, onde o texel e maior, a
+// resolucao angular iguala a do equador da origem, e perto das arestas e
+// mais fina. O custo e ~20% mais texels que a imagem original (6 / pi^2 da
+// area contra 1 / 2); com largura / 4 seriam 25% menos texels, mas o centro
+// das faces ficaria ~27% mais grosso que o equador.
+//
+// A filtragem (amostras bilineares e mips) e feita em espaco linear: os
+// bytes sRGB sao convertidos antes de misturar e de volta no fim.
+//
+// O TextureManager (loadCubemap) mapeia os containers das faces ou chama
+// bakeCubemap na thread de trabalho.
+//
+// As faces seguem a ordem e a orientacao de GL_TEXTURE_CUBE_MAP_POSITIVE_X
+// em diante, no espaco do objeto da esfera: a direcao (x, y, z) cai no mesmo
+// texel que sphericalUV (triangle_frag.glsl) daria na imagem original.
+
+constexpr size_t cubemap_face_count = 6;
+
+using CubemapChains = std::array<TextureChain, cubemap_face_count>;
+
+// Lado da face para uma imagem equiretangular de largura source_width:
+// largura / pi, arredondado para um multiplo de 4 (blocos BC).
+int cubemapFaceSize(int source_width);
+
+// Reprojeta com 2x2 amostras bilineares por texel, linhas divididas entre as
+// threads, e gera mips (e BC1/BC3 se compress) para cada face.
+bool bakeCubemap(const std::string& source_file, bool compress, CubemapChains& faces);
+
+// cache/<nome>_cube<face>_bc.bmtx ou _rgb.bmtx.
+std::string cubemapContainerPath(const std::string& source_file, size_t face,
+					bool compressed, const std::string& directory = "cache");
+
+// bakeCubemap + um container por face.
+bool bakeCubemapContainers(const std::string& source_file, bool compress);
@@ -0,0 +1,740 @@
+#include "texture_manager.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+#include "texture_bake.h"
+#include "texture_cubemap.h"
+
+namespace {
+
+// Azul escuro, proximo da media do oceano, para o globo nao piscar em branco.
+const unsigned char placeholder_texel[3] = { 10, 30, 80 };
+
+// Quanto o MIN_LOD cai por quadro depois que um nivel mais fino chega.
+const float lod_fade_per_frame = 0.125f;
+
+volatile unsigned char touched_pages;
+
+// Le um byte por pagina para que as faltas de pagina (e a leitura do disco,
+// se o arquivo nao estiver no page cache) acontecam aqui e nao no memcpy
+// feito na thread do GL.
+void touchPages(const MappedFile& file) {
+	const size_t page_size = 4096;
+	unsigned char sum = 0;
+	for (size_t offset = 0; offset < file.size(); offset += page_size) {
+		sum ^= file.data()[offset];
+	}
+	touched_pages = sum;
+}
+
+void setTextureParameters(GLenum target) {
+	// As faces do cubemap emendam pelas bordas, sem repetir.
+	const GLint wrap = target == GL_TEXTURE_CUBE_MAP ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, wrap);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, wrap);
+}
+
+bool sameLayout(const TextureChainView& a, const TextureChainView& b) {
+	return a.internal_format == b.internal_format && a.format == b.format &&
+		a.type == b.type && a.levels.size() == b.levels.size() &&
+		a.levels[0].width == b.levels[0].width && a.levels[0].height == b.levels[0].height;
+}
+
+// cache/<nome>_bc_<largura>x<altura>.bmtx: a camada refeita no tamanho de
+// outra nao sobrescreve o container da imagem original.
+std::string layerContainerPath(const std::string& file, bool compress,
+							   const TextureChainView& like) {
+	std::string path = textureContainerPath(file, compress);
+	path.insert(path.size() - 5, "_" + std::to_string(like.levels[0].width) + "x" +
+		std::to_string(like.levels[0].height));
+	return path;
+}
+
+// Camada que nao pode ser lida: zeros no layout de like, preto tanto em RGB
+// quanto em BC1/BC3.
+void blackLayer(const TextureChainView& like, TextureChain& chain) {
+	chain.internal_format = like.internal_format;
+	chain.format = like.format;
+	chain.type = like.type;
+	chain.levels.resize(like.levels.size());
+	for (size_t level = 0; level < like.levels.size(); level++) {
+		chain.levels[level].width = like.levels[level].width;
+		chain.levels[level].height = like.levels[level].height;
+		chain.levels[level].data.assign(like.levels[level].size, 0);
+	}
+}
+
+}
+
+TextureManager::~TextureManager() {
+	// Sem contexto GL aqui; so garante que a thread nao fique solta.
+	stopWorker();
+}
+
+void TextureManager::stopWorker() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	if (worker.joinable()) {
+		worker.join();
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	ready.clear();
+	requests.clear();
+	in_flight = 0;
+	stopping = false;
+}
+
+GLuint TextureManager::load(const std::string& texture_file) {
+	return createTexture(GL_TEXTURE_2D, { texture_file });
+}
+
+GLuint TextureManager::loadArray(const std::vector<std::string>& layer_files) {
+	assert(!layer_files.empty());
+	return createTexture(GL_TEXTURE_2D_ARRAY, layer_files);
+}
+
+GLuint TextureManager::loadCubemap(const std::string& texture_file) {
+	return createTexture(GL_TEXTURE_CUBE_MAP, { texture_file });
+}
+
+GLuint TextureManager::createTexture(GLenum target, const std::vector<std::string>& files) {
+	std::cout << "Carregando texture ... " << files[0];
+	if (files.size() > 1) {
+		std::cout << " (+" << files.size() - 1 << " camadas)";
+	}
+	std::cout << std::endl;
+
+	GLuint texture_id;
+	glGenTextures(1, &texture_id);
+	glBindTexture(target, texture_id);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if (target == GL_TEXTURE_2D_ARRAY) {
+		// As camadas alem da primeira ficam pretas ate a textura chegar.
+		std::vector<unsigned char> texels(files.size() * 3, 0);
+		std::copy_n(placeholder_texel, 3, texels.begin());
+		glTexImage3D(target, 0, GL_RGB, 1, 1, static_cast<GLsizei>(files.size()), 0,
+			GL_RGB, GL_UNSIGNED_BYTE, texels.data());
+	} else if (target == GL_TEXTURE_CUBE_MAP) {
+		for (size_t face = 0; face < cubemap_face_count; face++) {
+			glTexImage2D(static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face), 0, GL_RGB,
+				1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, placeholder_texel);
+		}
+	} else {
+		glTexImage2D(target, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE,
+			placeholder_texel
+		);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	setTextureParameters(target);
+
+	glBindTexture(target, 0);
+
+	textures.push_back(texture_id);
+
+	if (max_texture_size == 0) {
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+		glGetIntegerv(GL_MAX_CUBE_MAP_TEXTURE_SIZE, &max_cube_map_size);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		requests.push_back(request{ texture_id, target, files,
+									compress_textures && GLEW_EXT_texture_compression_s3tc,
+									target == GL_TEXTURE_CUBE_MAP ? max_cube_map_size : max_texture_size });
+		in_flight++;
+	}
+	wake.notify_one();
+
+	if (!worker.joinable()) {
+		worker = std::thread(&TextureManager::workerLoop, this);
+	}
+
+	return texture_id;
+}
+
+// Sem like: o container em cache/ ou a imagem preparada na hora. Com like
+// (camadas de uma array): o container da imagem se ja tiver o layout de like,
+// senao o container refeito nesse layout; sem imagem, a camada fica preta.
+bool TextureManager::loadLayer(const std::string& file, bool compress, int max_size,
+							   const TextureChainView* like, layerImage& layer) {
+	const std::string container_path = textureContainerPath(file, compress);
+	if (mapTextureContainer(container_path, file, layer.mapping, layer.view)) {
+		// Um container gravado para uma GPU com limite maior.
+		limitTextureChain(layer.view, max_size);
+		if (!like || sameLayout(layer.view, *like)) {
+			touchPages(layer.mapping);
+			return true;
+		}
+		layer.mapping.close();
+	}
+
+	if (!like) {
+		layer.view = TextureChainView{};
+		if (!bakeTexture(file, compress, layer.chain, max_size)) {
+			return false;
+		}
+		storeTextureContainer(container_path, file, layer.chain);
+		layer.view = textureChainView(layer.chain);
+		return true;
+	}
+
+	const std::string layer_path = layerContainerPath(file, compress, *like);
+	if (mapTextureContainer(layer_path, file, layer.mapping, layer.view) &&
+		sameLayout(layer.view, *like)) {
+		touchPages(layer.mapping);
+		return true;
+	}
+	layer.mapping.close();
+
+	if (bakeTextureLike(file, *like, layer.chain)) {
+		storeTextureContainer(layer_path, file, layer.chain);
+	} else {
+		std::cout << "Erro ao ler camada, usando preto - " << file << std::endl;
+		blackLayer(*like, layer.chain);
+	}
+	layer.view = textureChainView(layer.chain);
+	return true;
+}
+
+// Os containers das seis faces, ou o cubemap preparado na hora e gravado.
+bool TextureManager::loadCubemapFaces(const std::string& file, bool compress, int max_size,
+									  std::vector<layerImage>& faces) {
+	bool mapped = true;
+	for (size_t face = 0; face < cubemap_face_count && mapped; face++) {
+		mapped = mapTextureContainer(cubemapContainerPath(file, face, compress), file,
+			faces[face].mapping, faces[face].view);
+	}
+
+	if (mapped) {
+		for (layerImage& face : faces) {
+			limitTextureChain(face.view, max_size);
+			touchPages(face.mapping);
+		}
+		return true;
+	}
+
+	CubemapChains baked;
+	if (!bakeCubemap(file, compress, baked)) {
+		return false;
+	}
+
+	for (size_t face = 0; face < cubemap_face_count; face++) {
+		limitTextureChain(baked[face], max_size);
+		storeTextureContainer(cubemapContainerPath(file, face, compress), file, baked[face]);
+
+		faces[face].mapping.close();
+		faces[face].chain = std::move(baked[face]);
+		faces[face].view = textureChainView(faces[face].chain);
+	}
+	return true;
+}
+
+void TextureManager::workerLoop() {
+	for (;;) {
+		request next;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return stopping || !requests.empty(); });
+			if (stopping) {
+				return;
+			}
+			next = requests.front();
+			requests.pop_front();
+		}
+
+		decoded image;
+		image.texture = next.texture;
+		image.target = next.target;
+		image.file = next.files[0];
+
+		bool loaded_image = false;
+		if (next.target == GL_TEXTURE_CUBE_MAP) {
+			image.layers.resize(cubemap_face_count);
+			loaded_image = loadCubemapFaces(next.files[0], next.compress, next.max_size,
+				image.layers);
+		} else {
+			image.layers.resize(next.files.size());
+			loaded_image = loadLayer(next.files[0], next.compress, next.max_size, nullptr,
+				image.layers[0]);
+			for (size_t layer = 1; loaded_image && layer < next.files.size(); layer++) {
+				loadLayer(next.files[layer], next.compress, next.max_size,
+					&image.layers[0].view, image.layers[layer]);
+			}
+		}
+		if (!loaded_image) {
+			image.layers.clear();
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		ready.push_back(std::move(image));
+	}
+}
+
+// Com ARB_buffer_storage o PBO fica mapeado de forma persistente e so e
+// recriado quando um lote maior chega; antes de reescreve-lo espera o
+// fence do upload anterior. Sem a extensao, mapeia a cada upload invalidando
+// o conteudo. Devolve nullptr se nao houver PBO utilizavel.
+unsigned char* TextureManager::mapPixelBuffer(size_t size) {
+	if (GLEW_ARB_buffer_storage) {
+		if (size > pixel_buffer_size) {
+			if (upload_fence) {
+				glDeleteSync(upload_fence);
+				upload_fence = nullptr;
+			}
+			glDeleteBuffers(1, &pixel_buffer);
+
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glGenBuffers(1, &pixel_buffer);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer);
+			glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+			pixel_buffer_mapping = static_cast<unsigned char*>(
+				glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags));
+			pixel_buffer_size = pixel_buffer_mapping ? size : 0;
+			return pixel_buffer_mapping;
+		}
+
+		if (upload_fence) {
+			glClientWaitSync(upload_fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			glDeleteSync(upload_fence);
+			upload_fence = nullptr;
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer);
+		return pixel_buffer_mapping;
+	}
+
+	if (pixel_buffer == 0) {
+		glGenBuffers(1, &pixel_buffer);
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer);
+	if (size > pixel_buffer_size) {
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		pixel_buffer_size = size;
+	}
+
+	// Invalidar evita esperar um upload anterior que ainda le o buffer.
+	return static_cast<unsigned char*>(glMapBufferRange(
+		GL_PIXEL_UNPACK_BUFFER, 0, size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+}
+
+// Define um nivel com todas as camadas, vindo do PBO (em sequencia a partir
+// de offset) ou da memoria de cada camada, e desce BASE_LEVEL ate ele.
+// MIN_LOD sobe para o quadro continuar amostrando o nivel anterior e depois
+// cai aos poucos em update().
+void TextureManager::uploadLevel(decoded& image, size_t level, bool from_pixel_buffer,
+								 size_t offset) {
+	const TextureChainView& chain = image.view();
+	const TextureLevelView& source = chain.levels[level];
+	const GLenum target = image.target;
+	const GLint index = static_cast<GLint>(level);
+
+	glBindTexture(target, image.texture);
+
+	// Com o PBO ligado o ponteiro e um deslocamento no buffer.
+	const void* buffer_data = reinterpret_cast<const void*>(offset);
+
+	if (target == GL_TEXTURE_2D_ARRAY) {
+		// Do PBO as camadas estao juntas e sobem em uma chamada; da memoria o
+		// nivel e alocado e cada camada sobe sozinha.
+		const GLsizei layer_count = static_cast<GLsizei>(image.layers.size());
+		const void* data = from_pixel_buffer ? buffer_data : nullptr;
+
+		if (chain.compressed()) {
+			glCompressedTexImage3D(target, index, chain.internal_format,
+				source.width, source.height, layer_count, 0,
+				static_cast<GLsizei>(image.levelSize(level)), data);
+		} else {
+			glTexImage3D(target, index, chain.internal_format,
+				source.width, source.height, layer_count, 0,
+				chain.format, chain.type, data);
+		}
+
+		for (GLint layer = 0; !from_pixel_buffer && layer < layer_count; layer++) {
+			const TextureLevelView& layer_level = image.layers[layer].view.levels[level];
+			if (chain.compressed()) {
+				glCompressedTexSubImage3D(target, index, 0, 0, layer,
+					source.width, source.height, 1, chain.internal_format,
+					static_cast<GLsizei>(layer_level.size), layer_level.data);
+			} else {
+				glTexSubImage3D(target, index, 0, 0, layer,
+					source.width, source.height, 1, chain.format, chain.type,
+					layer_level.data);
+			}
+		}
+	} else if (target == GL_TEXTURE_CUBE_MAP) {
+		// Uma chamada por face; do PBO as faces estao em sequencia.
+		for (size_t face = 0; face < image.layers.size(); face++) {
+			const GLenum face_target = static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face);
+			const void* data = from_pixel_buffer ?
+				reinterpret_cast<const void*>(offset + face * source.size) :
+				static_cast<const void*>(image.layers[face].view.levels[level].data);
+
+			if (chain.compressed()) {
+				glCompressedTexImage2D(face_target, index,
+					chain.internal_format, source.width, source.height, 0,
+					static_cast<GLsizei>(source.size), data);
+			} else {
+				glTexImage2D(face_target, index,
+					chain.internal_format, source.width, source.height, 0,
+					chain.format, chain.type, data);
+			}
+		}
+	} else {
+		const void* data = from_pixel_buffer ? buffer_data :
+			static_cast<const void*>(source.data);
+
+		if (chain.compressed()) {
+			glCompressedTexImage2D(target, index,
+				chain.internal_format, source.width, source.height, 0,
+				static_cast<GLsizei>(source.size), data);
+		} else {
+			glTexImage2D(target, index,
+				chain.internal_format, source.width, source.height, 0,
+				chain.format, chain.type, data);
+		}
+	}
+
+	if (image.next_level == chain.levels.size()) {
+		glTexParameteri(target, GL_TEXTURE_MAX_LEVEL,
+			static_cast<GLint>(chain.levels.size()) - 1);
+	} else {
+		// No maximo um nivel de transicao: varios niveis no mesmo quadro
+		// nunca chegaram a aparecer.
+		image.min_lod = std::min(1.0f,
+			image.min_lod + static_cast<float>(image.next_level - level));
+	}
+
+	image.next_level = level;
+	glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, index);
+	glTexParameterf(target, GL_TEXTURE_MIN_LOD, image.min_lod);
+
+	const size_t size = image.levelSize(level);
+	image.resident_bytes += size;
+	frame_stats.resident_bytes += size;
+	frame_stats.peak_bytes = std::max(frame_stats.peak_bytes, frame_stats.resident_bytes);
+	frame_stats.uploaded_levels++;
+}
+
+// Sobe BASE_LEVEL e redefine o nivel que saiu com tamanho 0, o que libera a
+// memoria dele em uma textura mutavel.
+void TextureManager::dropTopLevel(decoded& image) {
+	const TextureChainView& chain = image.view();
+	const size_t level = image.next_level;
+	const GLenum target = image.target;
+	const GLenum format = chain.compressed() ? GL_RGBA : chain.format;
+	const GLenum type = chain.compressed() ? GL_UNSIGNED_BYTE : chain.type;
+
+	glBindTexture(target, image.texture);
+	glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(level + 1));
+	glTexParameterf(target, GL_TEXTURE_MIN_LOD, 0.0f);
+	if (target == GL_TEXTURE_2D_ARRAY) {
+		glTexImage3D(target, static_cast<GLint>(level), chain.internal_format, 0, 0, 0, 0,
+			format, type, nullptr);
+	} else if (target == GL_TEXTURE_CUBE_MAP) {
+		for (size_t face = 0; face < image.layers.size(); face++) {
+			glTexImage2D(static_cast<GLenum>(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face),
+				static_cast<GLint>(level), chain.internal_format, 0, 0, 0,
+				format, type, nullptr);
+		}
+	} else {
+		glTexImage2D(target, static_cast<GLint>(level), chain.internal_format, 0, 0, 0,
+			format, type, nullptr);
+	}
+	glBindTexture(target, 0);
+
+	const size_t size = image.levelSize(level);
+	image.resident_bytes -= size;
+	frame_stats.resident_bytes -= size;
+	frame_stats.dropped_levels++;
+
+	image.min_lod = 0.0f;
+	image.next_level = level + 1;
+	image.wanted_level = std::max(image.wanted_level, image.next_level);
+}
+
+// A textura usada ha mais tempo (e antes de used_before) que ainda tem um
+// nivel para perder alem do menor.
+TextureManager::decoded* TextureManager::leastRecentlyUsed(std::uint64_t used_before) {
+	decoded* victim = nullptr;
+	for (decoded& image : loaded) {
+		const bool droppable = image.next_level + 1 < image.view().levels.size();
+		if (droppable && image.last_used < used_before &&
+			(!victim || image.last_used < victim->last_used)) {
+			victim = &image;
+		}
+	}
+	return victim;
+}
+
+// Texturas usadas no ultimo quadro voltam a querer todos os niveis e abrem
+// espaco para o proximo deles descartando niveis das menos usadas.
+void TextureManager::makeRoom() {
+	const size_t budget = frame_stats.budget_bytes;
+
+	for (decoded& image : loaded) {
+		if (image.last_used + 1 < frame) {
+			continue;
+		}
+		image.wanted_level = 0;
+
+		if (budget == 0 || image.next_level == 0) {
+			continue;
+		}
+
+		const size_t needed = image.levelSize(image.next_level - 1);
+		while (frame_stats.resident_bytes + needed > budget) {
+			decoded* victim = leastRecentlyUsed(image.last_used);
+			if (!victim) {
+				break;
+			}
+			dropTopLevel(*victim);
+		}
+	}
+}
+
+// Se o orcamento baixou (ou tudo esta em uso), descarta das menos usadas ate
+// caber, mesmo que estejam na tela.
+void TextureManager::enforceBudget() {
+	const size_t budget = frame_stats.budget_bytes;
+	if (budget == 0) {
+		return;
+	}
+
+	while (frame_stats.resident_bytes > budget) {
+		decoded* victim = leastRecentlyUsed(frame + 1);
+		if (!victim) {
+			break;
+		}
+		dropTopLevel(*victim);
+	}
+}
+
+// Em rodadas, cada textura em streaming contribui com o seu proximo nivel
+// (o menor que falta) ate o orcamento de bytes acabar; o de tempo corta a
+// copia no meio se preciso. Tudo vai em um unico mapeamento do PBO. Um nivel
+// que estouraria o orcamento de VRAM espera.
+void TextureManager::streamLevels() {
+	struct plannedLevel {
+		decoded* image;
+		size_t level;
+		size_t offset;
+	};
+
+	std::vector<plannedLevel> batch;
+	size_t batch_bytes = 0;
+
+	std::vector<size_t> next_levels;
+	for (const decoded& image : loaded) {
+		next_levels.push_back(image.next_level);
+	}
+
+	for (bool added = true, full = false; added && !full;) {
+		added = false;
+		size_t index = 0;
+		for (decoded& image : loaded) {
+			size_t& next_level = next_levels[index++];
+			if (next_level <= image.wanted_level) {
+				continue;
+			}
+
+			const size_t size = image.levelSize(next_level - 1);
+			if (frame_stats.budget_bytes > 0 &&
+				frame_stats.resident_bytes + batch_bytes + size > frame_stats.budget_bytes) {
+				continue;
+			}
+			if (!batch.empty() && batch_bytes + size > upload_budget.bytes) {
+				full = true;
+				break;
+			}
+
+			next_level--;
+			batch.push_back(plannedLevel{ &image, next_level, batch_bytes });
+			batch_bytes += size;
+			added = true;
+		}
+	}
+
+	if (batch.empty()) {
+		return;
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	auto overBudget = [&]() {
+		const std::chrono::duration<double, std::milli> elapsed =
+			std::chrono::steady_clock::now() - start;
+		return elapsed.count() > upload_budget.milliseconds;
+	};
+
+	unsigned char* mapped = mapPixelBuffer(batch_bytes);
+	size_t count = batch.size();
+
+	if (mapped) {
+		for (size_t index = 0; index < batch.size(); index++) {
+			if (index > 0 && overBudget()) {
+				count = index;
+				break;
+			}
+			// As camadas do nivel em sequencia.
+			size_t offset = batch[index].offset;
+			for (const layerImage& layer : batch[index].image->layers) {
+				const TextureLevelView& level = layer.view.levels[batch[index].level];
+				std::memcpy(mapped + offset, level.data, level.size);
+				offset += level.size;
+			}
+		}
+		if (!pixel_buffer_mapping) {
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+	} else {
+		// Sem PBO o proprio mapeamento e a origem do upload.
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	for (size_t index = 0; index < count; index++) {
+		const plannedLevel& planned = batch[index];
+		if (!mapped && index > 0 && overBudget()) {
+			break;
+		}
+
+		// Do PBO a copia para a textura fica com o driver, sem bloquear a
+		// CPU.
+		uploadLevel(*planned.image, planned.level, mapped != nullptr, planned.offset);
+		glBindTexture(planned.image->target, 0);
+	}
+
+	if (mapped && pixel_buffer_mapping) {
+		upload_fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureManager::update() {
+	frame++;
+
+	std::deque<decoded> arrived;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		arrived.swap(ready);
+		in_flight -= arrived.size();
+	}
+
+	for (decoded& image : arrived) {
+		if (image.layers.empty()) {
+			std::cout << "Erro ao carregar textura, mantendo placeholder - "
+				<< image.file << std::endl;
+			continue;
+		}
+
+		image.next_level = image.view().levels.size();
+		image.last_used = frame;
+		loaded.push_back(std::move(image));
+	}
+
+	makeRoom();
+	streamLevels();
+	enforceBudget();
+
+	frame_stats.textures = loaded.size();
+	frame_stats.streaming = 0;
+	frame_stats.reduced = 0;
+
+	for (decoded& image : loaded) {
+		if (image.min_lod > 0.0f) {
+			image.min_lod = std::max(0.0f, image.min_lod - lod_fade_per_frame);
+			glBindTexture(image.target, image.texture);
+			glTexParameterf(image.target, GL_TEXTURE_MIN_LOD, image.min_lod);
+			glBindTexture(image.target, 0);
+		}
+
+		if (image.wanted_level > 0) {
+			frame_stats.reduced++;
+		}
+
+		if (image.next_level > image.wanted_level || image.min_lod > 0.0f) {
+			frame_stats.streaming++;
+			continue;
+		}
+
+		if (image.announced) {
+			continue;
+		}
+		image.announced = true;
+
+		const TextureChainView& chain = image.view();
+		std::cout << "Textura pronta - " << image.file << " ("
+			<< chain.levels[0].width << "x" << chain.levels[0].height;
+		if (image.target == GL_TEXTURE_2D_ARRAY) {
+			std::cout << "x" << image.layers.size() << " camadas";
+		} else if (image.target == GL_TEXTURE_CUBE_MAP) {
+			std::cout << " por face, cubemap";
+		}
+		std::cout << ", " << chain.levels.size() << " niveis, "
+			<< (chain.compressed() ? "comprimida, " : "")
+			<< (image.layers[0].mapping.isOpen() ? "mapeada, " : "")
+			<< image.resident_bytes / 1024 << " KB residentes)" << std::endl;
+	}
+}
+
+void TextureManager::touch(GLuint texture) {
+	for (decoded& image : loaded) {
+		if (image.texture == texture) {
+			image.last_used = frame;
+			return;
+		}
+	}
+}
+
+void TextureManager::release() {
+	stopWorker();
+	loaded.clear();
+
+	const size_t budget = frame_stats.budget_bytes;
+	frame_stats = Stats{};
+	frame_stats.budget_bytes = budget;
+
+	glDeleteTextures(static_cast<GLsizei>(textures.size()), textures.data());
+	textures.clear();
+
+	if (upload_fence) {
+		glDeleteSync(upload_fence);
+		upload_fence = nullptr;
+	}
+
+	glDeleteBuffers(1, &pixel_buffer);
+	pixel_buffer = 0;
+	pixel_buffer_size = 0;
+	pixel_buffer_mapping = nullptr;
+}
+
+size_t TextureManager::pending() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return in_flight + frame_stats.streaming;
+}
+
+size_t TextureManager::residentBytes(GLuint texture) const {
+	for (const decoded& image : loaded) {
+		if (image.texture == texture) {
+			return image.resident_bytes;
+		}
+	}
+	return 0;
+}
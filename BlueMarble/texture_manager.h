@@ -0,0 +1,199 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "texture_container.h"
+
+// Carrega texturas sem bloquear o render loop. load() devolve na hora um id
+// com um placeholder 1x1; a decodificacao roda em uma thread de trabalho e
+// update(), chamado uma vez por quadro na thread do GL, envia as imagens
+// prontas por um pixel buffer object e troca o conteudo da textura.
+//
+// A thread de trabalho mapeia o container pre-processado em cache/ (mips
+// prontos e, com compressao ligada e EXT_texture_compression_s3tc presente,
+// em BC1/BC3) e ja toca as paginas do mapeamento; update() copia direto do
+// mapeamento para um PBO mapeado de forma persistente (ARB_buffer_storage),
+// entao com o arquivo no page cache resta so a transferencia para a GPU. Se
+// o container faltar ou estiver desatualizado, prepara a textura na hora
+// (texture_bake.h) e grava o container para as proximas execucoes.
+//
+// Os niveis sobem do menor para o maior, espalhados pelos quadros dentro de
+// um orcamento de bytes e de tempo: o globo aparece logo e ganha nitidez aos
+// poucos. GL_TEXTURE_BASE_LEVEL fica no nivel mais fino ja enviado, entao a
+// amostragem nunca le um nivel que ainda nao chegou, e GL_TEXTURE_MIN_LOD
+// suaviza a troca para o nivel seguinte.
+//
+// Cada textura conta os bytes dos niveis residentes. Com um orcamento de
+// VRAM definido, as texturas usadas (touch()) tomam espaco das menos usadas
+// recentemente, que perdem os niveis mais finos um a um (nunca o menor); uma
+// textura reduzida volta a receber os niveis quando e usada de novo e ha
+// espaco.
+//
+// loadArray() monta uma GL_TEXTURE_2D_ARRAY e loadCubemap() uma
+// GL_TEXTURE_CUBE_MAP pelo mesmo caminho: as camadas (ou faces) tem o mesmo
+// tamanho, formato e mips, cada nivel sobe com todas e conta os bytes de
+// todas.
+class TextureManager {
+public:
+	struct UploadBudget {
+		// Bytes copiados para o PBO por quadro; um nivel maior que isto
+		// ainda sobe, sozinho.
+		size_t bytes = 4 * 1024 * 1024;
+		// Tempo de CPU gasto em copias e uploads por quadro.
+		double milliseconds = 2.0;
+	};
+
+	struct Stats {
+		size_t textures = 0;
+		// Ainda recebendo niveis.
+		size_t streaming = 0;
+		// Com niveis descartados pelo orcamento.
+		size_t reduced = 0;
+		// Bytes enviados dos niveis residentes (o driver pode guardar RGB8
+		// como RGBA8).
+		size_t resident_bytes = 0;
+		size_t peak_bytes = 0;
+		// 0 = sem limite.
+		size_t budget_bytes = 0;
+		// Acumulados desde o inicio.
+		size_t uploaded_levels = 0;
+		size_t dropped_levels = 0;
+	};
+
+	TextureManager() = default;
+	~TextureManager();
+
+	TextureManager(const TextureManager&) = delete;
+	TextureManager& operator=(const TextureManager&) = delete;
+
+	GLuint load(const std::string& texture_file);
+
+	// Uma camada por arquivo, na ordem dada. Uma camada que nao bate com a
+	// primeira e refeita na thread de trabalho e guardada em cache/ com o
+	// tamanho no nome; uma que nao pode ser lida fica preta. Sem a primeira
+	// camada a textura fica com o placeholder.
+	GLuint loadArray(const std::vector<std::string>& layer_files);
+
+	// Imagem equiretangular reprojetada nas seis faces (texture_cubemap.h),
+	// dos containers das faces em cache/ ou preparada na thread de trabalho.
+	GLuint loadCubemap(const std::string& texture_file);
+
+	// Vale para os load() seguintes.
+	void setCompression(bool enabled) { compress_textures = enabled; }
+
+	void setUploadBudget(const UploadBudget& budget) { upload_budget = budget; }
+
+	// Limite para a soma dos niveis residentes; 0 desliga.
+	void setMemoryBudget(size_t bytes) { frame_stats.budget_bytes = bytes; }
+
+	// Marca a textura como usada neste quadro (chamar ao liga-la).
+	void touch(GLuint texture);
+
+	// Recebe as imagens prontas e envia os proximos niveis dentro do
+	// orcamento.
+	void update();
+
+	// Para a thread de trabalho e apaga as texturas e o PBO.
+	void release();
+
+	// Texturas ainda sem todos os niveis; chamar na thread do GL.
+	size_t pending() const;
+
+	// Bytes residentes de uma textura (0 enquanto tem o placeholder).
+	size_t residentBytes(GLuint texture) const;
+
+	const Stats& stats() const { return frame_stats; }
+
+private:
+	struct request {
+		GLuint texture;
+		// GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY ou GL_TEXTURE_CUBE_MAP.
+		GLenum target;
+		// Um arquivo por camada; o cubemap tem um so para as seis faces.
+		std::vector<std::string> files;
+		bool compress;
+		// GL_MAX_TEXTURE_SIZE; niveis maiores nao sao preparados nem enviados.
+		int max_size;
+	};
+
+	// Container mapeado, ou, se foi preciso preparar a imagem, a cadeia em
+	// memoria; view aponta para um dos dois (os buffers dos niveis nao mudam
+	// de lugar quando a camada e movida).
+	struct layerImage {
+		MappedFile mapping;
+		TextureChain chain;
+		TextureChainView view;
+	};
+
+	struct decoded {
+		GLuint texture = 0;
+		GLenum target = GL_TEXTURE_2D;
+		std::string file;
+		// Camadas ou faces, todas com o layout da primeira. Vazio se a
+		// imagem nao pode ser lida.
+		std::vector<layerImage> layers;
+
+		// Estado na thread do GL. Os niveis de next_level para cima estao
+		// residentes; o streaming continua ate wanted_level, que sobe quando
+		// o orcamento descarta niveis.
+		size_t next_level = 0;
+		size_t wanted_level = 0;
+		float min_lod = 0.0f;
+		size_t resident_bytes = 0;
+		std::uint64_t last_used = 0;
+		bool announced = false;
+
+		const TextureChainView& view() const { return layers[0].view; }
+		// Bytes do nivel somando as camadas.
+		size_t levelSize(size_t level) const { return layers[0].view.levels[level].size * layers.size(); }
+	};
+
+	GLuint createTexture(GLenum target, const std::vector<std::string>& files);
+	static bool loadLayer(const std::string& file, bool compress, int max_size,
+						  const TextureChainView* like, layerImage& layer);
+	static bool loadCubemapFaces(const std::string& file, bool compress, int max_size,
+								 std::vector<layerImage>& faces);
+	void workerLoop();
+	void stopWorker();
+	unsigned char* mapPixelBuffer(size_t size);
+	void streamLevels();
+	void uploadLevel(decoded& image, size_t level, bool from_pixel_buffer, size_t offset);
+	void dropTopLevel(decoded& image);
+	decoded* leastRecentlyUsed(std::uint64_t used_before);
+	void makeRoom();
+	void enforceBudget();
+
+	std::thread worker;
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping = false;
+
+	std::deque<request> requests;
+	std::deque<decoded> ready;
+	size_t in_flight = 0;
+
+	std::list<decoded> loaded;
+	UploadBudget upload_budget;
+	std::uint64_t frame = 0;
+	Stats frame_stats;
+
+	std::vector<GLuint> textures;
+	GLuint pixel_buffer = 0;
+	size_t pixel_buffer_size = 0;
+	// Mapeamento persistente do PBO; o fence marca o fim do ultimo upload
+	// que leu dele.
+	unsigned char* pixel_buffer_mapping = nullptr;
+	GLsync upload_fence = nullptr;
+	bool compress_textures = true;
+	GLint max_texture_size = 0;
+	GLint max_cube_map_size = 0;
+};
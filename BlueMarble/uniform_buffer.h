@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+#include <GL/glew.h>
+
+// Buffer de um bloco de uniforms std140, ligado a um binding fixo
+// (glBindBufferBase) e compartilhado por todos os programas que declaram o
+// bloco. update() reescreve o conteudo inteiro a cada quadro; o buffer e
+// orfanado antes para nao esperar a GPU terminar o quadro anterior.
+class UniformBuffer {
+public:
+	UniformBuffer() = default;
+
+	UniformBuffer(const UniformBuffer&) = delete;
+	UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+	void initialize(GLuint binding, size_t size);
+	void update(const void* data);
+	void release();
+
+private:
+	GLuint buffer = 0;
+	GLuint binding = 0;
+	size_t size = 0;
+};
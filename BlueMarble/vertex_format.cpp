@@ -0,0 +1,173 @@
+#include "vertex_format.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "parallel.h"
+
+namespace {
+
+std::int16_t toSnorm16(float value) {
+	return static_cast<std::int16_t>(
+		std::round(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+std::uint16_t toUnorm16(float value) {
+	return static_cast<std::uint16_t>(
+		std::round(glm::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+glm::vec2 signNotZero(const glm::vec2& value) {
+	return glm::vec2{ value.x >= 0.0f ? 1.0f : -1.0f,
+					  value.y >= 0.0f ? 1.0f : -1.0f };
+}
+
+}
+
+const char* vertexFormatName(VertexFormat format) {
+	switch (format) {
+	case VertexFormat::Full:
+		return "full";
+	case VertexFormat::Packed:
+		return "packed";
+	}
+	return "?";
+}
+
+bool parseVertexFormat(const std::string& name, VertexFormat& format) {
+	for (VertexFormat candidate : { VertexFormat::Full, VertexFormat::Packed }) {
+		if (name == vertexFormatName(candidate)) {
+			format = candidate;
+			return true;
+		}
+	}
+	return false;
+}
+
+size_t vertexFormatStride(VertexFormat format) {
+	switch (format) {
+	case VertexFormat::Full:
+		return sizeof(vertex);
+	case VertexFormat::Packed:
+		return sizeof(packedVertex);
+	}
+	return 0;
+}
+
+glm::vec2 octahedralEncode(const glm::vec3& normal) {
+	const glm::vec3 n = normal / (std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z));
+	glm::vec2 encoded{ n.x, n.y };
+	if (n.z < 0.0f) {
+		encoded = (1.0f - glm::abs(glm::vec2{ encoded.y, encoded.x })) * signNotZero(encoded);
+	}
+	return encoded;
+}
+
+glm::vec3 octahedralDecode(const glm::vec2& encoded) {
+	glm::vec3 n{ encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y) };
+	if (n.z < 0.0f) {
+		const glm::vec2 folded = (1.0f - glm::abs(glm::vec2{ n.y, n.x })) * signNotZero(glm::vec2{ n.x, n.y });
+		n.x = folded.x;
+		n.y = folded.y;
+	}
+	return glm::normalize(n);
+}
+
+packedVertex packVertex(const vertex& source) {
+	const glm::vec2 normal = octahedralEncode(source.normal);
+
+	packedVertex packed;
+	packed.position[0] = toSnorm16(source.position.x);
+	packed.position[1] = toSnorm16(source.position.y);
+	packed.position[2] = toSnorm16(source.position.z);
+	packed.position[3] = 32767;
+	packed.normal[0] = toSnorm16(normal.x);
+	packed.normal[1] = toSnorm16(normal.y);
+	packed.uv[0] = toUnorm16(source.uv.x / packed_u_scale);
+	packed.uv[1] = toUnorm16(source.uv.y);
+	return packed;
+}
+
+void encodeVertices(VertexFormat format, const vertex* source, size_t count,
+					void* destination) {
+	switch (format) {
+	case VertexFormat::Full:
+		std::memcpy(destination, source, count * sizeof(vertex));
+		break;
+	case VertexFormat::Packed: {
+		packedVertex* packed = static_cast<packedVertex*>(destination);
+		parallelFor(0, count, [&](size_t begin, size_t end) {
+			for (size_t index = begin; index < end; index++) {
+				packed[index] = packVertex(source[index]);
+			}
+		}, 4096);
+		break;
+	}
+	}
+}
+
+void encodeVertices(VertexFormat format, const vertex* source, const GLuint* remap,
+					size_t count, void* destination) {
+	switch (format) {
+	case VertexFormat::Full: {
+		vertex* full = static_cast<vertex*>(destination);
+		parallelFor(0, count, [&](size_t begin, size_t end) {
+			for (size_t index = begin; index < end; index++) {
+				full[index] = source[remap[index]];
+			}
+		}, 4096);
+		break;
+	}
+	case VertexFormat::Packed: {
+		packedVertex* packed = static_cast<packedVertex*>(destination);
+		parallelFor(0, count, [&](size_t begin, size_t end) {
+			for (size_t index = begin; index < end; index++) {
+				packed[index] = packVertex(source[remap[index]]);
+			}
+		}, 4096);
+		break;
+	}
+	}
+}
+
+void setupVertexFormat(VertexFormat format) {
+	switch (format) {
+	case VertexFormat::Full:
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glEnableVertexAttribArray(2);
+		glEnableVertexAttribArray(3);
+
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), nullptr);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_TRUE, sizeof(vertex),
+			reinterpret_cast<void*>(offsetof(vertex, normal))
+		);
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_TRUE, sizeof(vertex),
+			reinterpret_cast<void*>(offsetof(vertex, color))
+		);
+		glVertexAttribPointer(3, 2, GL_FLOAT, GL_TRUE, sizeof(vertex),
+			reinterpret_cast<void*>(offsetof(vertex, uv))
+		);
+		break;
+
+	case VertexFormat::Packed:
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glDisableVertexAttribArray(2);
+		glEnableVertexAttribArray(3);
+
+		glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, sizeof(packedVertex),
+			reinterpret_cast<void*>(offsetof(packedVertex, position))
+		);
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(packedVertex),
+			reinterpret_cast<void*>(offsetof(packedVertex, normal))
+		);
+		glVertexAttribPointer(3, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(packedVertex),
+			reinterpret_cast<void*>(offsetof(packedVertex, uv))
+		);
+
+		// Sem stream de cor: o atributo desligado usa o valor constante.
+		glVertexAttrib3f(2, 1.0f, 1.0f, 1.0f);
+		break;
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "sphere_mesh.h"
+
+enum class VertexFormat {
+	// struct vertex: posicao, normal, cor e uv em float (44 bytes).
+	Full,
+	// packedVertex: posicao snorm16, normal octaedrica snorm16 e uv unorm16,
+	// sem cor (16 bytes). u vai de 0 a 2 (copias da costura somam 1) e e
+	// guardado como u / 2; o shader (PACKED_VERTEX) desfaz a escala.
+	Packed
+};
+
+struct packedVertex {
+	std::int16_t position[4];
+	std::int16_t normal[2];
+	std::uint16_t uv[2];
+};
+
+// Escala de u em packedVertex::uv.
+constexpr float packed_u_scale = 2.0f;
+
+static_assert(sizeof(packedVertex) == 16, "packedVertex deve ter 16 bytes");
+
+const char* vertexFormatName(VertexFormat format);
+bool parseVertexFormat(const std::string& name, VertexFormat& format);
+
+size_t vertexFormatStride(VertexFormat format);
+
+glm::vec2 octahedralEncode(const glm::vec3& normal);
+glm::vec3 octahedralDecode(const glm::vec2& encoded);
+
+packedVertex packVertex(const vertex& source);
+
+// Converte count vertices para o formato pedido em destination, que precisa
+// ter count * vertexFormatStride(format) bytes.
+void encodeVertices(VertexFormat format, const vertex* source, size_t count,
+					void* destination);
+
+// Como acima, mas o vertice i da saida e source[remap[i]].
+void encodeVertices(VertexFormat format, const vertex* source, const GLuint* remap,
+					size_t count, void* destination);
+
+// Configura os atributos 0-3 do VAO ligado a partir do GL_ARRAY_BUFFER ligado.
+void setupVertexFormat(VertexFormat format);
@@ -0,0 +1,525 @@
+#include "virtual_texture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <stb_image.h>
+
+namespace {
+
+std::uint32_t nextPowerOfTwo(std::uint32_t value) {
+	std::uint32_t power = 1;
+	while (power < value) {
+		power <<= 1;
+	}
+	return power;
+}
+
+size_t keyLevel(std::uint64_t key) {
+	return static_cast<size_t>(key >> 48);
+}
+
+std::uint32_t keyX(std::uint64_t key) {
+	return static_cast<std::uint32_t>(key & 0xFFFFFF);
+}
+
+std::uint32_t keyY(std::uint64_t key) {
+	return static_cast<std::uint32_t>((key >> 24) & 0xFFFFFF);
+}
+
+// Mesmo formato lido por triangle_frag.glsl: (x, y) da pagina no atlas e
+// nivel da pagina, em RGBA8.
+std::uint32_t packEntry(std::uint32_t slot_x, std::uint32_t slot_y, size_t level) {
+	return slot_x | (slot_y << 8) | (static_cast<std::uint32_t>(level) << 16) | 0xFF000000u;
+}
+
+}
+
+VirtualTexture::~VirtualTexture() {
+	stopWorker();
+}
+
+std::uint64_t VirtualTexture::pageKey(size_t level, std::uint32_t x, std::uint32_t y) {
+	return (static_cast<std::uint64_t>(level) << 48) |
+		(static_cast<std::uint64_t>(y) << 24) | x;
+}
+
+bool VirtualTexture::initialize(const std::string& file, int viewport_width,
+					int viewport_height, const Settings& new_settings) {
+	settings = new_settings;
+
+	if (!source.open(file)) {
+		std::cout << "Textura virtual nao encontrada - " << file << std::endl;
+		return false;
+	}
+
+	const GLuint page_size = source.pageSize();
+
+	GLint max_texture_size = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+	settings.atlas_pages = std::min<GLuint>(settings.atlas_pages,
+		std::min<GLuint>(256, static_cast<GLuint>(max_texture_size) / page_size));
+
+	// Atlas sem mips: o nivel certo da piramide ja e escolhido no shader.
+	const GLsizei atlas_size = static_cast<GLsizei>(settings.atlas_pages * page_size);
+	glGenTextures(1, &atlas_texture);
+	glBindTexture(GL_TEXTURE_2D, atlas_texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, atlas_size, atlas_size, 0,
+		GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+	free_slots.clear();
+	for (std::uint32_t slot = settings.atlas_pages * settings.atlas_pages; slot > 0; slot--) {
+		free_slots.push_back(slot - 1);
+	}
+
+	// Page table com um mip por nivel; o nivel 0 e arredondado para potencia
+	// de 2 para que o mip k sempre tenha espaco para as paginas do nivel k.
+	table_width = nextPowerOfTwo(source.level(0).tiles_x);
+	table_height = nextPowerOfTwo(source.level(0).tiles_y);
+
+	glGenTextures(1, &page_table_texture);
+	glBindTexture(GL_TEXTURE_2D, page_table_texture);
+	page_table.assign(source.levelCount(), std::vector<std::uint32_t>{});
+	for (size_t level = 0; level < source.levelCount(); level++) {
+		glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_RGBA8,
+			std::max<GLsizei>(1, table_width >> level),
+			std::max<GLsizei>(1, table_height >> level), 0,
+			GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		page_table[level].assign(static_cast<size_t>(source.level(level).tiles_x) *
+			source.level(level).tiles_y, 0);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+		static_cast<GLint>(source.levelCount()) - 1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	feedback_width = std::max(1, viewport_width / static_cast<int>(settings.feedback_divisor));
+	feedback_height = std::max(1, viewport_height / static_cast<int>(settings.feedback_divisor));
+
+	glGenRenderbuffers(1, &feedback_color);
+	glBindRenderbuffer(GL_RENDERBUFFER, feedback_color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, feedback_width, feedback_height);
+	glGenRenderbuffers(1, &feedback_depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, feedback_depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, feedback_width, feedback_height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &feedback_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, feedback_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+		GL_RENDERBUFFER, feedback_color);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+		GL_RENDERBUFFER, feedback_depth);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "Framebuffer de feedback incompleto" << std::endl;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glGenBuffers(2, feedback_buffers.data());
+	for (GLuint buffer : feedback_buffers) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER,
+			static_cast<size_t>(feedback_width) * feedback_height * 4,
+			nullptr, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	feedback_written = {};
+	feedback_index = 0;
+
+	// O nivel mais grosso fica sempre residente: toda pagina tem um
+	// ancestral para mostrar enquanto a sua nao chega.
+	const size_t top = source.levelCount() - 1;
+	for (std::uint32_t y = 0; y < source.level(top).tiles_y; y++) {
+		for (std::uint32_t x = 0; x < source.level(top).tiles_x; x++) {
+			std::vector<unsigned char> rgba;
+			const std::uint64_t key = pageKey(top, x, y);
+			if (decodePage(key, rgba)) {
+				uploadPage(key, rgba, true);
+			}
+		}
+	}
+	rebuildPageTable();
+
+	worker = std::thread(&VirtualTexture::workerLoop, this);
+
+	std::cout << "Textura virtual - " << file << " (" << source.width() << "x"
+		<< source.height() << ", " << source.levelCount() << " niveis, atlas "
+		<< atlas_size << "x" << atlas_size << ")" << std::endl;
+
+	return true;
+}
+
+void VirtualTexture::stopWorker() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	if (worker.joinable()) {
+		worker.join();
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	requests.clear();
+	decoded.clear();
+	stopping = false;
+}
+
+void VirtualTexture::release() {
+	stopWorker();
+
+	glDeleteBuffers(2, feedback_buffers.data());
+	glDeleteFramebuffers(1, &feedback_framebuffer);
+	glDeleteRenderbuffers(1, &feedback_depth);
+	glDeleteRenderbuffers(1, &feedback_color);
+	glDeleteTextures(1, &page_table_texture);
+	glDeleteTextures(1, &atlas_texture);
+
+	feedback_buffers = {};
+	feedback_framebuffer = feedback_depth = feedback_color = 0;
+	page_table_texture = atlas_texture = 0;
+
+	resident.clear();
+	lru.clear();
+	pending.clear();
+	failed.clear();
+	free_slots.clear();
+	page_table.clear();
+	source.close();
+}
+
+bool VirtualTexture::decodePage(std::uint64_t key, std::vector<unsigned char>& rgba) const {
+	size_t bytes = 0;
+	const unsigned char* jpeg = source.tileData(keyLevel(key), keyX(key), keyY(key), bytes);
+	if (!jpeg) {
+		return false;
+	}
+
+	int page_width = 0;
+	int page_height = 0;
+	int number_of_components = 0;
+	unsigned char* pixels = stbi_load_from_memory(jpeg, static_cast<int>(bytes),
+		&page_width, &page_height, &number_of_components, 4);
+
+	if (!pixels || page_width != static_cast<int>(source.pageSize()) ||
+		page_height != static_cast<int>(source.pageSize())) {
+		stbi_image_free(pixels);
+		return false;
+	}
+
+	rgba.assign(pixels, pixels + static_cast<size_t>(page_width) * page_height * 4);
+	stbi_image_free(pixels);
+	return true;
+}
+
+void VirtualTexture::workerLoop() {
+	for (;;) {
+		std::uint64_t key;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return stopping || !requests.empty(); });
+			if (stopping) {
+				return;
+			}
+			key = requests.front();
+			requests.pop_front();
+		}
+
+		decodedPage page;
+		page.key = key;
+		if (!decodePage(key, page.rgba)) {
+			page.rgba.clear();
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		decoded.push_back(std::move(page));
+	}
+}
+
+void VirtualTexture::beginFeedback() {
+	glBindFramebuffer(GL_FRAMEBUFFER, feedback_framebuffer);
+	glViewport(0, 0, feedback_width, feedback_height);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void VirtualTexture::endFeedback(int viewport_width, int viewport_height) {
+	// Com o PBO ligado glReadPixels so enfileira a copia; o mapeamento fica
+	// para dois quadros depois, quando ela ja terminou.
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, feedback_buffers[feedback_index]);
+	glReadPixels(0, 0, feedback_width, feedback_height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	feedback_written[feedback_index] = true;
+	feedback_index = 1 - feedback_index;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, viewport_width, viewport_height);
+}
+
+void VirtualTexture::readFeedback() {
+	if (!feedback_written[feedback_index]) {
+		return;
+	}
+
+	const size_t pixel_count = static_cast<size_t>(feedback_width) * feedback_height;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, feedback_buffers[feedback_index]);
+	const unsigned char* pixels = static_cast<const unsigned char*>(glMapBufferRange(
+		GL_PIXEL_PACK_BUFFER, 0, pixel_count * 4, GL_MAP_READ_BIT));
+
+	std::unordered_set<std::uint64_t> seen;
+	if (pixels) {
+		for (size_t pixel = 0; pixel < pixel_count; pixel++) {
+			const unsigned char* texel = pixels + pixel * 4;
+			if (texel[3] == 0) {
+				continue;
+			}
+
+			const size_t level = texel[3] - 1u;
+			const std::uint32_t x = texel[0] | ((texel[2] & 0x0Fu) << 8);
+			const std::uint32_t y = texel[1] | ((texel[2] >> 4) << 8);
+			if (level < source.levelCount() && x < source.level(level).tiles_x &&
+				y < source.level(level).tiles_y) {
+				seen.insert(pageKey(level, x, y));
+			}
+		}
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	// Cada pagina vista segura tambem os seus ancestrais, que sao o que o
+	// shader mostra enquanto ela nao chega.
+	std::unordered_set<std::uint64_t> needed;
+	for (std::uint64_t key : seen) {
+		size_t level = keyLevel(key);
+		std::uint32_t x = keyX(key);
+		std::uint32_t y = keyY(key);
+
+		for (;;) {
+			if (!needed.insert(pageKey(level, x, y)).second || level + 1 >= source.levelCount()) {
+				break;
+			}
+			level++;
+			x = std::min(x / 2, source.level(level).tiles_x - 1);
+			y = std::min(y / 2, source.level(level).tiles_y - 1);
+		}
+	}
+
+	std::vector<std::uint64_t> missing;
+	for (std::uint64_t key : needed) {
+		auto found = resident.find(key);
+		if (found != resident.end()) {
+			found->second.last_used = frame;
+			if (!found->second.pinned) {
+				lru.splice(lru.begin(), lru, found->second.lru);
+			}
+		} else if (pending.count(key) == 0 && failed.count(key) == 0) {
+			missing.push_back(key);
+		}
+	}
+
+	// Niveis grossos primeiro: cobrem mais tela por pagina.
+	std::sort(missing.begin(), missing.end(), [](std::uint64_t a, std::uint64_t b) {
+		return keyLevel(a) > keyLevel(b);
+	});
+
+	frame_stats.requested = needed.size();
+
+	for (std::uint64_t key : missing) {
+		if (pending.size() >= settings.max_pending) {
+			break;
+		}
+		requestPage(key);
+	}
+}
+
+void VirtualTexture::requestPage(std::uint64_t key) {
+	pending.insert(key);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		requests.push_back(key);
+	}
+	wake.notify_one();
+}
+
+bool VirtualTexture::allocateSlot(std::uint32_t& slot) {
+	if (!free_slots.empty()) {
+		slot = free_slots.back();
+		free_slots.pop_back();
+		return true;
+	}
+
+	// A menos usada sai, desde que nao tenha sido vista neste quadro.
+	if (lru.empty()) {
+		return false;
+	}
+
+	const std::uint64_t victim = lru.back();
+	auto found = resident.find(victim);
+	if (found->second.last_used >= frame) {
+		return false;
+	}
+
+	slot = found->second.slot;
+	lru.pop_back();
+	resident.erase(found);
+	frame_stats.evicted++;
+	page_table_dirty = true;
+	return true;
+}
+
+bool VirtualTexture::uploadPage(std::uint64_t key, const std::vector<unsigned char>& rgba,
+					bool pinned) {
+	std::uint32_t slot;
+	if (!allocateSlot(slot)) {
+		return false;
+	}
+
+	const GLint page_size = static_cast<GLint>(source.pageSize());
+	const GLint slot_x = static_cast<GLint>(slot % settings.atlas_pages);
+	const GLint slot_y = static_cast<GLint>(slot / settings.atlas_pages);
+
+	glBindTexture(GL_TEXTURE_2D, atlas_texture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, slot_x * page_size, slot_y * page_size,
+		page_size, page_size, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	page entry;
+	entry.slot = slot;
+	entry.last_used = frame;
+	entry.pinned = pinned;
+	if (!pinned) {
+		lru.push_front(key);
+		entry.lru = lru.begin();
+	}
+	resident[key] = entry;
+	page_table_dirty = true;
+	return true;
+}
+
+void VirtualTexture::rebuildPageTable() {
+	glBindTexture(GL_TEXTURE_2D, page_table_texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	// De cima para baixo: uma pagina sem residente herda a entrada do pai.
+	for (size_t level = source.levelCount(); level-- > 0;) {
+		const VirtualTextureLevel& current = source.level(level);
+		std::vector<std::uint32_t>& entries = page_table[level];
+		bool changed = false;
+
+		for (std::uint32_t y = 0; y < current.tiles_y; y++) {
+			for (std::uint32_t x = 0; x < current.tiles_x; x++) {
+				std::uint32_t entry = 0;
+
+				auto found = resident.find(pageKey(level, x, y));
+				if (found != resident.end()) {
+					entry = packEntry(found->second.slot % settings.atlas_pages,
+						found->second.slot / settings.atlas_pages, level);
+				} else if (level + 1 < source.levelCount()) {
+					const VirtualTextureLevel& parent = source.level(level + 1);
+					entry = page_table[level + 1][
+						std::min(y / 2, parent.tiles_y - 1) * parent.tiles_x +
+						std::min(x / 2, parent.tiles_x - 1)];
+				}
+
+				std::uint32_t& stored = entries[static_cast<size_t>(y) * current.tiles_x + x];
+				changed = changed || stored != entry;
+				stored = entry;
+			}
+		}
+
+		if (changed || frame == 0) {
+			glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0,
+				current.tiles_x, current.tiles_y, GL_RGBA, GL_UNSIGNED_BYTE,
+				entries.data());
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	page_table_dirty = false;
+}
+
+void VirtualTexture::update() {
+	frame++;
+	frame_stats.evicted = 0;
+
+	readFeedback();
+
+	for (size_t uploads = 0; uploads < settings.uploads_per_frame; uploads++) {
+		decodedPage page;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (decoded.empty()) {
+				break;
+			}
+			page = std::move(decoded.front());
+			decoded.pop_front();
+		}
+
+		if (page.rgba.empty()) {
+			// Sai de pending (que limita os pedidos) e nao e pedida de novo.
+			std::cout << "Erro ao decodificar pagina virtual - nivel " << keyLevel(page.key)
+				<< " (" << keyX(page.key) << ", " << keyY(page.key) << ")" << std::endl;
+			pending.erase(page.key);
+			failed.insert(page.key);
+			continue;
+		}
+
+		if (!uploadPage(page.key, page.rgba, false)) {
+			// Atlas cheio de paginas em uso: a pagina ja decodificada espera
+			// na frente da fila, ainda em pending, por uma vaga.
+			std::lock_guard<std::mutex> lock(mutex);
+			decoded.push_front(std::move(page));
+			break;
+		}
+		pending.erase(page.key);
+	}
+
+	if (page_table_dirty) {
+		rebuildPageTable();
+	}
+
+	frame_stats.resident = resident.size();
+	frame_stats.pending = pending.size();
+}
+
+void VirtualTexture::bindTextures(GLint atlas_unit, GLint page_table_unit) const {
+	glActiveTexture(GL_TEXTURE0 + atlas_unit);
+	glBindTexture(GL_TEXTURE_2D, atlas_texture);
+	glActiveTexture(GL_TEXTURE0 + page_table_unit);
+	glBindTexture(GL_TEXTURE_2D, page_table_texture);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void VirtualTexture::configure(const ShaderProgram& program, bool feedback) const {
+	std::array<GLfloat, virtual_texture_max_levels * 2> level_sizes{};
+	for (size_t level = 0; level < source.levelCount(); level++) {
+		level_sizes[level * 2] = static_cast<GLfloat>(source.level(level).width);
+		level_sizes[level * 2 + 1] = static_cast<GLfloat>(source.level(level).height);
+	}
+
+	glUniform2fv(program.uniformLocation("vt_level_size"),
+		static_cast<GLsizei>(virtual_texture_max_levels), level_sizes.data());
+	glUniform1i(program.uniformLocation("vt_max_level"),
+		static_cast<GLint>(source.levelCount()) - 1);
+	glUniform1f(program.uniformLocation("vt_page_content"),
+		static_cast<GLfloat>(source.pageContent()));
+	glUniform1f(program.uniformLocation("vt_page_border"),
+		static_cast<GLfloat>(source.border()));
+	glUniform1f(program.uniformLocation("vt_page_size"),
+		static_cast<GLfloat>(source.pageSize()));
+	glUniform1f(program.uniformLocation("vt_atlas_size"),
+		static_cast<GLfloat>(settings.atlas_pages * source.pageSize()));
+	// O passe de feedback tem derivadas feedback_divisor vezes maiores.
+	glUniform1f(program.uniformLocation("vt_lod_bias"),
+		feedback ? -std::log2(static_cast<GLfloat>(settings.feedback_divisor)) : 0.0f);
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "shader_program.h"
+#include "virtual_texture_file.h"
+
+// Textura virtual: so as paginas da piramide (virtual_texture_file.h) que a
+// camera precisa ficam em um atlas de tamanho fixo, entao a VRAM usada nao
+// depende do tamanho da imagem de origem.
+//
+// A cada quadro a cena e desenhada em baixa resolucao com a variante
+// VIRTUAL_FEEDBACK do shader; cada pixel grava a pagina e o nivel que
+// pediria. O resultado volta por um de dois PBOs, lido dois quadros depois
+// para o mapeamento nao esperar a copia; as paginas que faltam sao
+// decodificadas em uma thread de trabalho e enviadas ao atlas, e as menos
+// usadas recentemente saem quando o atlas enche. A page table (uma textura
+// com um mip por nivel da piramide) leva cada pagina virtual para o seu
+// lugar no atlas, ou para o ancestral residente mais proximo enquanto ela
+// nao chega; triangle_frag.glsl faz essa indirecao.
+class VirtualTexture {
+public:
+	struct Settings {
+		// Paginas por lado do atlas; limitado por GL_MAX_TEXTURE_SIZE.
+		GLuint atlas_pages = 32;
+		// O passe de feedback usa a resolucao da janela dividida por isto.
+		GLuint feedback_divisor = 8;
+		// Paginas enviadas ao atlas por quadro.
+		size_t uploads_per_frame = 16;
+		// Paginas pedidas a thread de trabalho e ainda nao entregues.
+		size_t max_pending = 64;
+	};
+
+	struct Stats {
+		size_t resident = 0;
+		size_t requested = 0;
+		size_t pending = 0;
+		size_t evicted = 0;
+	};
+
+	VirtualTexture() = default;
+	~VirtualTexture();
+
+	VirtualTexture(const VirtualTexture&) = delete;
+	VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+	bool initialize(const std::string& file, int viewport_width, int viewport_height,
+					const Settings& settings);
+	void release();
+
+	// Passe de feedback: liga o framebuffer pequeno; endFeedback le os
+	// pixels para um PBO e volta ao framebuffer padrao.
+	void beginFeedback();
+	void endFeedback(int viewport_width, int viewport_height);
+
+	// Processa o feedback do quadro anterior, pede paginas, envia as que
+	// ficaram prontas e atualiza a page table.
+	void update();
+
+	// Liga atlas e page table nas unidades dadas (as mesmas dos samplers
+	// vt_atlas e vt_page_table nos ProgramBindings).
+	void bindTextures(GLint atlas_unit, GLint page_table_unit) const;
+
+	// Grava os uniforms vt_* no programa ligado; os valores so mudam com a
+	// piramide, entao basta uma vez por programa. feedback indica a variante
+	// VIRTUAL_FEEDBACK.
+	void configure(const ShaderProgram& program, bool feedback) const;
+
+	const Stats& stats() const { return frame_stats; }
+
+private:
+	struct page {
+		std::uint32_t slot;
+		std::uint64_t last_used;
+		bool pinned;
+		std::list<std::uint64_t>::iterator lru;
+	};
+
+	struct decodedPage {
+		std::uint64_t key;
+		std::vector<unsigned char> rgba;
+	};
+
+	static std::uint64_t pageKey(size_t level, std::uint32_t x, std::uint32_t y);
+
+	void workerLoop();
+	void stopWorker();
+	bool decodePage(std::uint64_t key, std::vector<unsigned char>& rgba) const;
+	void readFeedback();
+	void requestPage(std::uint64_t key);
+	bool allocateSlot(std::uint32_t& slot);
+	// false se o atlas estiver cheio de paginas vistas neste quadro.
+	bool uploadPage(std::uint64_t key, const std::vector<unsigned char>& rgba, bool pinned);
+	void rebuildPageTable();
+
+	Settings settings;
+	VirtualTextureFile source;
+
+	GLuint atlas_texture = 0;
+	GLuint page_table_texture = 0;
+	GLuint feedback_framebuffer = 0;
+	GLuint feedback_color = 0;
+	GLuint feedback_depth = 0;
+	std::array<GLuint, 2> feedback_buffers{};
+	std::array<bool, 2> feedback_written{};
+	size_t feedback_index = 0;
+	int feedback_width = 0;
+	int feedback_height = 0;
+
+	// Tamanho (potencia de 2) do nivel 0 da page table.
+	std::uint32_t table_width = 0;
+	std::uint32_t table_height = 0;
+	// Uma entrada RGBA por pagina de cada nivel: (x, y) no atlas e nivel
+	// da pagina realmente usada.
+	std::vector<std::vector<std::uint32_t>> page_table;
+	bool page_table_dirty = true;
+
+	std::unordered_map<std::uint64_t, page> resident;
+	std::list<std::uint64_t> lru;
+	std::vector<std::uint32_t> free_slots;
+	// Pedidas e ainda nao enviadas ao atlas (na fila, decodificando ou
+	// decodificadas esperando uma vaga).
+	std::unordered_set<std::uint64_t> pending;
+	// Paginas cuja decodificacao falhou; nao sao pedidas de novo.
+	std::unordered_set<std::uint64_t> failed;
+	std::uint64_t frame = 0;
+
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping = false;
+	std::deque<std::uint64_t> requests;
+	std::deque<decodedPage> decoded;
+
+	Stats frame_stats;
+};
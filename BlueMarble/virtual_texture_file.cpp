@@ -0,0 +1,388 @@
+#include "virtual_texture_file.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include <stb_image.h>
+#include <stb_image_resize.h>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include "parallel.h"
+
+namespace {
+
+constexpr char virtual_texture_magic[8] = { 'B', 'M', 'V', 'T', 'E', 'X', '\0', '\0' };
+constexpr std::uint32_t virtual_texture_version = 1;
+
+struct virtualTextureHeader {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t page_size;
+	std::uint32_t border;
+	std::uint32_t level_count;
+	std::uint32_t tile_count;
+	std::uint32_t reserved;
+};
+
+struct levelImage {
+	int width;
+	int height;
+	std::vector<unsigned char> rgb;
+};
+
+void appendBytes(void* context, void* data, int size) {
+	std::vector<unsigned char>& bytes = *static_cast<std::vector<unsigned char>*>(context);
+	const unsigned char* begin = static_cast<const unsigned char*>(data);
+	bytes.insert(bytes.end(), begin, begin + size);
+}
+
+// Decodifica as partes em paralelo, cada uma no seu retangulo da imagem
+// final. Todas as partes de uma linha tem a mesma altura e as de uma coluna a
+// mesma largura.
+bool loadImageParts(const std::vector<std::string>& parts, std::uint32_t columns,
+					levelImage& image) {
+	const size_t rows = (parts.size() + columns - 1) / columns;
+	if (parts.empty() || columns == 0 || rows * columns != parts.size()) {
+		std::cout << "Numero de partes invalido - " << parts.size() << " para "
+			<< columns << " colunas" << std::endl;
+		return false;
+	}
+
+	std::vector<int> column_widths(columns, 0);
+	std::vector<int> row_heights(rows, 0);
+
+	for (size_t index = 0; index < parts.size(); index++) {
+		int width = 0;
+		int height = 0;
+		int number_of_components = 0;
+		if (!stbi_info(parts[index].c_str(), &width, &height, &number_of_components)) {
+			std::cout << "Erro ao ler imagem - " << parts[index] << std::endl;
+			return false;
+		}
+
+		int& column_width = column_widths[index % columns];
+		int& row_height = row_heights[index / columns];
+		if ((column_width != 0 && column_width != width) ||
+			(row_height != 0 && row_height != height)) {
+			std::cout << "Parte com tamanho incompativel - " << parts[index] << std::endl;
+			return false;
+		}
+		column_width = width;
+		row_height = height;
+	}
+
+	std::vector<int> column_offsets(columns + 1, 0);
+	std::vector<int> row_offsets(rows + 1, 0);
+	for (std::uint32_t column = 0; column < columns; column++) {
+		column_offsets[column + 1] = column_offsets[column] + column_widths[column];
+	}
+	for (size_t row = 0; row < rows; row++) {
+		row_offsets[row + 1] = row_offsets[row] + row_heights[row];
+	}
+
+	image.width = column_offsets[columns];
+	image.height = row_offsets[rows];
+	image.rgb.resize(static_cast<size_t>(image.width) * image.height * 3);
+
+	std::vector<char> loaded(parts.size(), 0);
+
+	parallelFor(0, parts.size(), [&](size_t part_begin, size_t part_end) {
+		for (size_t index = part_begin; index < part_end; index++) {
+			int width = 0;
+			int height = 0;
+			int number_of_components = 0;
+			unsigned char* pixels = stbi_load(parts[index].c_str(), &width, &height,
+				&number_of_components, 3);
+			if (!pixels) {
+				continue;
+			}
+
+			const size_t x = static_cast<size_t>(column_offsets[index % columns]);
+			const size_t y = static_cast<size_t>(row_offsets[index / columns]);
+			for (int row = 0; row < height; row++) {
+				std::memcpy(image.rgb.data() + ((y + row) * image.width + x) * 3,
+					pixels + static_cast<size_t>(row) * width * 3,
+					static_cast<size_t>(width) * 3);
+			}
+
+			stbi_image_free(pixels);
+			loaded[index] = 1;
+		}
+	});
+
+	for (size_t index = 0; index < parts.size(); index++) {
+		if (!loaded[index]) {
+			std::cout << "Erro ao ler imagem - " << parts[index] << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Copia a pagina (x, y) com bordas: u da a volta na costura, v repete a
+// primeira/ultima linha.
+void extractPage(const levelImage& image, std::uint32_t x, std::uint32_t y,
+				 const VirtualTextureBuildSettings& settings,
+				 std::vector<unsigned char>& page) {
+	const int content = static_cast<int>(settings.page_size - 2 * settings.border);
+	const int border = static_cast<int>(settings.border);
+	const int size = static_cast<int>(settings.page_size);
+
+	page.resize(static_cast<size_t>(size) * size * 3);
+
+	for (int row = 0; row < size; row++) {
+		const int source_y = std::clamp(static_cast<int>(y) * content + row - border,
+			0, image.height - 1);
+
+		for (int column = 0; column < size; column++) {
+			int source_x = (static_cast<int>(x) * content + column - border) % image.width;
+			if (source_x < 0) {
+				source_x += image.width;
+			}
+
+			std::memcpy(page.data() + (static_cast<size_t>(row) * size + column) * 3,
+				image.rgb.data() + (static_cast<size_t>(source_y) * image.width + source_x) * 3, 3);
+		}
+	}
+}
+
+}
+
+bool VirtualTextureFile::open(const std::string& path) {
+	close();
+
+	if (!file.open(path)) {
+		return false;
+	}
+
+	virtualTextureHeader header;
+	if (file.size() < sizeof(header)) {
+		close();
+		return false;
+	}
+	std::memcpy(&header, file.data(), sizeof(header));
+
+	const size_t levels_offset = sizeof(header);
+	const size_t tiles_offset = levels_offset + header.level_count * sizeof(VirtualTextureLevel);
+
+	if (std::memcmp(header.magic, virtual_texture_magic, sizeof(header.magic)) != 0 ||
+		header.version != virtual_texture_version ||
+		header.level_count == 0 || header.level_count > virtual_texture_max_levels ||
+		header.page_size <= 2 * header.border ||
+		tiles_offset + header.tile_count * sizeof(VirtualTextureTile) > file.size()) {
+		std::cout << "Textura virtual invalida - " << path << std::endl;
+		close();
+		return false;
+	}
+
+	page_size = header.page_size;
+	page_border = header.border;
+	level_count = header.level_count;
+	std::memcpy(levels, file.data() + levels_offset,
+		level_count * sizeof(VirtualTextureLevel));
+	tiles = reinterpret_cast<const VirtualTextureTile*>(file.data() + tiles_offset);
+	tile_count = header.tile_count;
+
+	return true;
+}
+
+void VirtualTextureFile::close() {
+	file.close();
+	tiles = nullptr;
+	tile_count = 0;
+	level_count = 0;
+}
+
+const unsigned char* VirtualTextureFile::tileData(size_t level_index, std::uint32_t x,
+					std::uint32_t y, size_t& bytes) const {
+	if (level_index >= level_count) {
+		return nullptr;
+	}
+
+	const VirtualTextureLevel& current = levels[level_index];
+	if (x >= current.tiles_x || y >= current.tiles_y) {
+		return nullptr;
+	}
+
+	const size_t index = current.first_tile + static_cast<size_t>(y) * current.tiles_x + x;
+	if (index >= tile_count || tiles[index].offset + tiles[index].bytes > file.size()) {
+		return nullptr;
+	}
+
+	bytes = tiles[index].bytes;
+	return file.data() + tiles[index].offset;
+}
+
+std::string virtualTexturePath(const std::string& source_file,
+					const std::string& directory) {
+	return directory + "/" + std::filesystem::path(source_file).stem().string() + ".bmvt";
+}
+
+bool decodeVirtualTextureLevel(const VirtualTextureFile& file, size_t level_index,
+					int channels, unsigned char* destination) {
+	if (level_index >= file.levelCount()) {
+		return false;
+	}
+
+	const VirtualTextureLevel& level = file.level(level_index);
+	const std::uint32_t content = file.pageContent();
+	const std::uint32_t border = file.border();
+	const size_t tile_count = static_cast<size_t>(level.tiles_x) * level.tiles_y;
+
+	std::vector<char> decoded(tile_count, 0);
+
+	parallelFor(0, tile_count, [&](size_t tile_begin, size_t tile_end) {
+		for (size_t tile = tile_begin; tile < tile_end; tile++) {
+			const std::uint32_t tile_x = static_cast<std::uint32_t>(tile % level.tiles_x);
+			const std::uint32_t tile_y = static_cast<std::uint32_t>(tile / level.tiles_x);
+
+			size_t bytes = 0;
+			const unsigned char* jpeg = file.tileData(level_index, tile_x, tile_y, bytes);
+			if (!jpeg) {
+				continue;
+			}
+
+			int page_width = 0;
+			int page_height = 0;
+			int number_of_components = 0;
+			unsigned char* page = stbi_load_from_memory(jpeg, static_cast<int>(bytes),
+				&page_width, &page_height, &number_of_components, channels);
+			if (!page || page_width != static_cast<int>(file.pageSize()) ||
+				page_height != static_cast<int>(file.pageSize())) {
+				stbi_image_free(page);
+				continue;
+			}
+
+			// Os tiles da ultima coluna e linha passam do fim da imagem.
+			const std::uint32_t x = tile_x * content;
+			const std::uint32_t y = tile_y * content;
+			const std::uint32_t copy_width = std::min(content, level.width - x);
+			const std::uint32_t copy_height = std::min(content, level.height - y);
+
+			for (std::uint32_t row = 0; row < copy_height; row++) {
+				std::memcpy(destination + ((static_cast<size_t>(y) + row) * level.width + x) * channels,
+					page + ((static_cast<size_t>(row) + border) * page_width + border) * channels,
+					static_cast<size_t>(copy_width) * channels);
+			}
+
+			stbi_image_free(page);
+			decoded[tile] = 1;
+		}
+	}, 4);
+
+	return std::all_of(decoded.begin(), decoded.end(), [](char ok) { return ok != 0; });
+}
+
+bool buildVirtualTexture(const std::string& source_file, const std::string& output_file,
+					const VirtualTextureBuildSettings& settings) {
+	return buildVirtualTexture(std::vector<std::string>{ source_file }, 1, output_file, settings);
+}
+
+bool buildVirtualTexture(const std::vector<std::string>& parts, std::uint32_t columns,
+					const std::string& output_file,
+					const VirtualTextureBuildSettings& settings) {
+	const auto start_time = std::chrono::steady_clock::now();
+	const std::uint32_t content = settings.page_size - 2 * settings.border;
+
+	levelImage image;
+	if (!loadImageParts(parts, columns, image)) {
+		return false;
+	}
+
+	std::vector<VirtualTextureLevel> levels;
+	std::vector<std::vector<unsigned char>> tile_bytes;
+
+	for (;;) {
+		VirtualTextureLevel level;
+		level.width = static_cast<std::uint32_t>(image.width);
+		level.height = static_cast<std::uint32_t>(image.height);
+		level.tiles_x = (level.width + content - 1) / content;
+		level.tiles_y = (level.height + content - 1) / content;
+		level.first_tile = static_cast<std::uint32_t>(tile_bytes.size());
+		levels.push_back(level);
+
+		tile_bytes.resize(tile_bytes.size() + static_cast<size_t>(level.tiles_x) * level.tiles_y);
+
+		parallelFor(0, level.tiles_y, [&](size_t row_begin, size_t row_end) {
+			std::vector<unsigned char> page;
+			for (size_t y = row_begin; y < row_end; y++) {
+				for (std::uint32_t x = 0; x < level.tiles_x; x++) {
+					extractPage(image, x, static_cast<std::uint32_t>(y), settings, page);
+
+					std::vector<unsigned char>& jpeg =
+						tile_bytes[level.first_tile + y * level.tiles_x + x];
+					stbi_write_jpg_to_func(appendBytes, &jpeg, settings.page_size,
+						settings.page_size, 3, page.data(), settings.jpeg_quality);
+				}
+			}
+		});
+
+		const bool single_tile = level.tiles_x == 1 && level.tiles_y == 1;
+		if (single_tile || levels.size() == virtual_texture_max_levels) {
+			break;
+		}
+
+		levelImage next;
+		next.width = std::max(1, image.width / 2);
+		next.height = std::max(1, image.height / 2);
+		next.rgb.resize(static_cast<size_t>(next.width) * next.height * 3);
+		stbir_resize(image.rgb.data(), image.width, image.height, image.width * 3,
+			next.rgb.data(), next.width, next.height, next.width * 3,
+			STBIR_TYPE_UINT8, 3, STBIR_ALPHA_CHANNEL_NONE, 0,
+			STBIR_EDGE_WRAP, STBIR_EDGE_CLAMP,
+			STBIR_FILTER_MITCHELL, STBIR_FILTER_MITCHELL,
+			STBIR_COLORSPACE_SRGB, nullptr);
+		image = std::move(next);
+	}
+
+	virtualTextureHeader header{};
+	std::memcpy(header.magic, virtual_texture_magic, sizeof(header.magic));
+	header.version = virtual_texture_version;
+	header.page_size = settings.page_size;
+	header.border = settings.border;
+	header.level_count = static_cast<std::uint32_t>(levels.size());
+	header.tile_count = static_cast<std::uint32_t>(tile_bytes.size());
+
+	std::vector<VirtualTextureTile> entries(tile_bytes.size());
+	std::uint64_t offset = sizeof(header) + levels.size() * sizeof(VirtualTextureLevel) +
+		entries.size() * sizeof(VirtualTextureTile);
+	for (size_t index = 0; index < entries.size(); index++) {
+		entries[index].offset = offset;
+		entries[index].bytes = static_cast<std::uint32_t>(tile_bytes[index].size());
+		offset += tile_bytes[index].size();
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(output_file).parent_path(), error);
+
+	std::ofstream stream{ output_file, std::ios::binary | std::ios::trunc };
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	stream.write(reinterpret_cast<const char*>(levels.data()),
+		levels.size() * sizeof(VirtualTextureLevel));
+	stream.write(reinterpret_cast<const char*>(entries.data()),
+		entries.size() * sizeof(VirtualTextureTile));
+	for (const std::vector<unsigned char>& jpeg : tile_bytes) {
+		stream.write(reinterpret_cast<const char*>(jpeg.data()), jpeg.size());
+	}
+
+	if (!stream) {
+		std::cout << "Erro ao gravar textura virtual - " << output_file << std::endl;
+		return false;
+	}
+
+	const std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - start_time;
+	std::cout << "Textura virtual gerada - " << output_file << " ("
+		<< levels.size() << " niveis, " << tile_bytes.size() << " tiles, "
+		<< offset / 1024 << " KB em " << elapsed.count() * 1000.0 << " ms)" << std::endl;
+
+	return true;
+}
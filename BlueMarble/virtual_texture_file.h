@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+// Piramide de tiles de uma imagem enorme para a textura virtual
+// (virtual_texture.h). Cada nivel e dividido em paginas de page_size pixels
+// quadrados: page_size - 2 * border pixels de conteudo e border pixels
+// copiados dos vizinhos em cada lado, para o filtro bilinear nao enxergar o
+// atlas. Os tiles sao JPEG e o arquivo tem uma tabela de deslocamentos, entao
+// um tile e lido direto do arquivo mapeado sem tocar o resto.
+
+struct VirtualTextureLevel {
+	std::uint32_t width;
+	std::uint32_t height;
+	std::uint32_t tiles_x;
+	std::uint32_t tiles_y;
+	// Indice do primeiro tile do nivel na tabela.
+	std::uint32_t first_tile;
+};
+
+// Entrada da tabela de tiles: deslocamento do JPEG no arquivo.
+struct VirtualTextureTile {
+	std::uint64_t offset;
+	std::uint32_t bytes;
+	std::uint32_t reserved;
+};
+
+constexpr size_t virtual_texture_max_levels = 16;
+
+class VirtualTextureFile {
+public:
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const { return file.isOpen(); }
+
+	std::uint32_t width() const { return levels[0].width; }
+	std::uint32_t height() const { return levels[0].height; }
+	std::uint32_t pageSize() const { return page_size; }
+	std::uint32_t border() const { return page_border; }
+	std::uint32_t pageContent() const { return page_size - 2 * page_border; }
+
+	size_t levelCount() const { return level_count; }
+	const VirtualTextureLevel& level(size_t index) const { return levels[index]; }
+
+	// JPEG do tile; nullptr fora da piramide.
+	const unsigned char* tileData(size_t level_index, std::uint32_t x, std::uint32_t y,
+					size_t& bytes) const;
+
+private:
+	MappedFile file;
+	std::uint32_t page_size = 0;
+	std::uint32_t page_border = 0;
+	size_t level_count = 0;
+	VirtualTextureLevel levels[virtual_texture_max_levels] = {};
+	const VirtualTextureTile* tiles = nullptr;
+	size_t tile_count = 0;
+};
+
+struct VirtualTextureBuildSettings {
+	std::uint32_t page_size = 128;
+	std::uint32_t border = 4;
+	int jpeg_quality = 90;
+};
+
+// cache/<nome>.bmvt.
+std::string virtualTexturePath(const std::string& source_file,
+					const std::string& directory = "cache");
+
+// Decodifica os tiles de um nivel em paralelo, cada um independente dos
+// outros, e copia o conteudo (sem as bordas) direto para destination: a
+// imagem inteira do nivel, channels (3 ou 4) bytes por texel, linhas
+// contiguas. O tempo cai com o numero de nucleos, ao contrario de um JPEG
+// unico.
+bool decodeVirtualTextureLevel(const VirtualTextureFile& file, size_t level, int channels,
+					unsigned char* destination);
+
+// Le source_file inteiro, gera os niveis com stb_image_resize e codifica os
+// tiles em paralelo. O ultimo nivel e o primeiro que cabe em um tile.
+bool buildVirtualTexture(const std::string& source_file, const std::string& output_file,
+					const VirtualTextureBuildSettings& settings = VirtualTextureBuildSettings{});
+
+// Mesmo, para uma imagem distribuida em partes (como o Blue Marble de
+// 86400x43200 em 8 partes de 21600x21600): parts em ordem de linhas, columns
+// por linha. As partes sao decodificadas em paralelo direto na imagem
+// montada.
+bool buildVirtualTexture(const std::vector<std::string>& parts, std::uint32_t columns,
+					const std::string& output_file,
+					const VirtualTextureBuildSettings& settings = VirtualTextureBuildSettings{});